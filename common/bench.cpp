@@ -0,0 +1,91 @@
+#include "bench.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+BenchTimer::BenchTimer(MPI_Comm comm, int warmup, int reps) : comm(comm), warmup(warmup), reps(reps) {
+    result.warmup = warmup;
+    result.reps = reps;
+}
+
+void BenchTimer::start() {
+    MPI_Barrier(comm);
+    volume_before = comm_volume();
+    started = MPI_Wtime();
+}
+
+double BenchTimer::stop() {
+    double elapsed = MPI_Wtime() - started;
+    CommVolume volume = comm_volume();
+    MPI_Allreduce(MPI_IN_PLACE, &elapsed, 1, MPI_DOUBLE, MPI_MAX, comm);
+
+    best_run = false;
+    if (run >= warmup) {
+        int timed = run - warmup;
+        volume_sum.bytes += volume.bytes - volume_before.bytes;
+        volume_sum.messages += volume.messages - volume_before.messages;
+        total += elapsed;
+        if (timed == 0 || elapsed < result.best) {
+            result.best = elapsed;
+            best_run = true;
+        }
+        result.mean = total / (timed + 1);
+        result.bytes = volume_sum.bytes / (timed + 1);
+        result.messages = volume_sum.messages / (timed + 1);
+    }
+    run++;
+    return elapsed;
+}
+
+bool parse_bench_args(int argc, char** argv, int first, int& warmup, int& reps) {
+    for (int i = first; i < argc; i++) {
+        std::string arg(argv[i]);
+        size_t eq = arg.find('=');
+        if (eq == std::string::npos) {
+            return false;
+        }
+        std::string key = arg.substr(0, eq);
+        int value = std::atoi(arg.c_str() + eq + 1);
+        if (key == "warmup") {
+            warmup = value;
+        } else if (key == "reps") {
+            reps = value;
+        } else {
+            return false;
+        }
+    }
+    return warmup >= 0 && reps > 0;
+}
+
+void bench_report(MPI_Comm comm, const std::string& program, const std::string& mode,
+                  const std::string& size, const BenchStats& stats) {
+    int rank, ranks;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &ranks);
+
+    long long mine[2] = {stats.bytes, stats.messages};
+    std::vector<long long> all(rank == 0 ? 2 * ranks : 0);
+    MPI_Gather(mine, 2, MPI_LONG_LONG, all.data(), 2, MPI_LONG_LONG, 0, comm);
+    if (rank != 0) {
+        return;
+    }
+
+    long long bytes_max = 0, bytes_total = 0, messages_total = 0;
+    std::ostringstream per_rank;
+    for (int r = 0; r < ranks; r++) {
+        bytes_max = std::max(bytes_max, all[2 * r]);
+        bytes_total += all[2 * r];
+        messages_total += all[2 * r + 1];
+        per_rank << (r ? ";" : "") << all[2 * r];
+    }
+    std::ostringstream line;
+    line << std::setprecision(6) << std::scientific
+         << "Bench: program=" << program << " mode=" << mode << " ranks=" << ranks << " size=" << size
+         << " best_s=" << stats.best << " mean_s=" << stats.mean << " warmup=" << stats.warmup
+         << " reps=" << stats.reps << " bytes_max=" << bytes_max << " bytes_total=" << bytes_total
+         << " messages_total=" << messages_total << " bytes_per_rank=" << per_rank.str() << "\n";
+    std::cout << line.str() << std::flush;
+}
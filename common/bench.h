@@ -0,0 +1,63 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "comm_volume.h"
+#include <mpi.h>
+#include <string>
+
+struct BenchStats {
+    double best = 0;       // Slowest rank of the fastest run
+    double mean = 0;
+    int warmup = 0;
+    int reps = 0;
+    long long bytes = 0;    // This rank's traffic per timed run
+    long long messages = 0;
+};
+
+// Times the runs of a mode's own repetition loop:
+//
+//     BenchTimer timer(comm, warmup, reps);
+//     for (int run = 0; run < timer.runs(); run++) {
+//         timer.start();
+//         ...
+//         double elapsed = timer.stop();
+//     }
+//
+// start() waits on a barrier and stop() returns the slowest rank's MPI_Wtime
+// span, so every rank sees the same value. The first warmup runs are left
+// out of the statistics.
+class BenchTimer {
+public:
+    BenchTimer(MPI_Comm comm, int warmup, int reps);
+
+    int runs() const { return warmup + reps; }
+    void start();
+    double stop();
+    // The run just stopped was timed and is the fastest so far
+    bool last_was_best() const { return best_run; }
+    const BenchStats& stats() const { return result; }
+
+private:
+    MPI_Comm comm;
+    int warmup;
+    int reps;
+    int run = 0;
+    double started = 0;
+    CommVolume volume_before;
+    CommVolume volume_sum;
+    double total = 0;
+    bool best_run = false;
+    BenchStats result;
+};
+
+// Accepts warmup=W and reps=R; returns false for any other argument.
+bool parse_bench_args(int argc, char** argv, int first, int& warmup, int& reps);
+
+// Prints one line on rank 0 that the benchmark harness parses:
+// "Bench: program=... mode=... ranks=... size=... best_s=... mean_s=...
+//  warmup=... reps=... bytes_max=... bytes_total=... messages_total=...
+//  bytes_per_rank=b0;b1;..." Collective over comm.
+void bench_report(MPI_Comm comm, const std::string& program, const std::string& mode,
+                  const std::string& size, const BenchStats& stats);
+
+#endif // BENCH_H
@@ -0,0 +1,273 @@
+// Runs every lab3/lab4 algorithm mode over size and rank-count sweeps and
+// collects the "Bench:" line each run prints into CSV and JSON reports with
+// time, speedup, parallel efficiency and per-rank communication volume.
+//
+// Usage: bench_harness [quick=0|1] [ranks=1,2,4] [warmup=W] [reps=R]
+//                      [only=SUBSTRING] [launcher="mpirun --oversubscribe"]
+//                      [out=build/bench]
+// Paths are relative to the common/ directory, where make bench runs it.
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct HarnessOptions {
+    bool quick = false;
+    std::vector<int> ranks = {1, 2, 4};
+    int warmup = 1;
+    int reps = 3;
+    std::string only;
+    std::string launcher = "mpirun --oversubscribe";
+    std::string out = "build/bench";
+};
+
+// One algorithm mode: "{size}" in args is replaced by each size. Fixed-shape
+// modes have a single empty size and their own rank counts.
+struct Sweep {
+    std::string program;
+    std::string args;
+    std::vector<std::string> sizes;
+    std::vector<int> ranks;
+};
+
+struct Result {
+    std::string program;
+    std::string mode;
+    std::string args;
+    std::string size;
+    int ranks = 0;
+    double best = 0;
+    double mean = 0;
+    double speedup = 1;
+    double efficiency = 1;
+    long long bytes_max = 0;
+    long long bytes_total = 0;
+    long long messages_total = 0;
+    std::string bytes_per_rank;
+};
+
+static std::vector<int> parse_list(const std::string& text) {
+    std::vector<int> values;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        values.push_back(std::atoi(item.c_str()));
+    }
+    return values;
+}
+
+static bool parse_options(int argc, char** argv, HarnessOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        size_t eq = arg.find('=');
+        if (eq == std::string::npos) {
+            return false;
+        }
+        std::string key = arg.substr(0, eq);
+        std::string value = arg.substr(eq + 1);
+        if (key == "quick") {
+            options.quick = std::atoi(value.c_str()) != 0;
+        } else if (key == "ranks") {
+            options.ranks = parse_list(value);
+        } else if (key == "warmup") {
+            options.warmup = std::atoi(value.c_str());
+        } else if (key == "reps") {
+            options.reps = std::atoi(value.c_str());
+        } else if (key == "only") {
+            options.only = value;
+        } else if (key == "launcher") {
+            options.launcher = value;
+        } else if (key == "out") {
+            options.out = value;
+        } else {
+            return false;
+        }
+    }
+    return !options.ranks.empty() && options.warmup >= 0 && options.reps > 0;
+}
+
+static std::vector<Sweep> default_sweeps(const HarnessOptions& options) {
+    const std::string lab3 = "../lab3/matrix_mult";
+    const std::string sort = "../lab4/build/parallel_sort";
+    const std::string gemv = "../lab4/build/matrix_vector_mult";
+    bool quick = options.quick;
+    std::vector<int> ranks = options.ranks;
+
+    return {
+        // The element-per-rank originals only run at their fixed rank counts
+        {lab3, "matrix4", {""}, {4}},
+        {lab3, "matrix20", {""}, {20}},
+        {sort, "systolic", {""}, {5, 25}},
+        {gemv, "0", {""}, {5}},
+        {gemv, "1", {""}, {5}},
+
+        {lab3, "gemm size={size}", quick ? std::vector<std::string>{"256"} : std::vector<std::string>{"512", "1024"}, ranks},
+        {lab3, "pipeline size={size}", quick ? std::vector<std::string>{"256"} : std::vector<std::string>{"512", "1024"}, ranks},
+        {sort, "sample keys={size}", quick ? std::vector<std::string>{"262144"} : std::vector<std::string>{"1048576", "8388608"}, ranks},
+        {sort, "merge_split keys={size}", quick ? std::vector<std::string>{"262144"} : std::vector<std::string>{"1048576", "8388608"}, ranks},
+        {gemv, "ring n={size}", quick ? std::vector<std::string>{"1024"} : std::vector<std::string>{"4096", "8192"}, ranks},
+        {gemv, "pipeline n={size}", quick ? std::vector<std::string>{"1024"} : std::vector<std::string>{"4096", "8192"}, ranks},
+        {lab3, "shared size={size}", quick ? std::vector<std::string>{"256"} : std::vector<std::string>{"512", "1024"}, ranks},
+        {gemv, "shared n={size}", quick ? std::vector<std::string>{"1024"} : std::vector<std::string>{"4096", "8192"}, ranks},
+        {gemv, "stream vectors=64 batch=16 n={size}", quick ? std::vector<std::string>{"1024"} : std::vector<std::string>{"4096"}, ranks},
+    };
+}
+
+static std::string substitute(std::string text, const std::string& size) {
+    size_t at = text.find("{size}");
+    if (at != std::string::npos) {
+        text.replace(at, 6, size);
+    }
+    return text;
+}
+
+// Fields of a "Bench: key=value ..." line
+static std::map<std::string, std::string> parse_bench_line(const std::string& line) {
+    std::map<std::string, std::string> fields;
+    std::stringstream stream(line.substr(line.find(':') + 1));
+    std::string token;
+    while (stream >> token) {
+        size_t eq = token.find('=');
+        if (eq != std::string::npos) {
+            fields[token.substr(0, eq)] = token.substr(eq + 1);
+        }
+    }
+    return fields;
+}
+
+static bool run_one(const HarnessOptions& options, const std::string& program, const std::string& args,
+                    int ranks, Result& result) {
+    std::string command = options.launcher + " -np " + std::to_string(ranks) + " " + program + " " + args +
+                          " warmup=" + std::to_string(options.warmup) + " reps=" + std::to_string(options.reps) +
+                          " 2>&1";
+    std::cerr << "  " << command << std::endl;
+    FILE* pipe = popen(command.c_str(), "r");
+    if (pipe == nullptr) {
+        return false;
+    }
+    std::string bench_line;
+    char buffer[4096];
+    while (std::fgets(buffer, sizeof(buffer), pipe) != nullptr) {
+        std::string line(buffer);
+        if (line.compare(0, 7, "Bench: ") == 0) {
+            bench_line = line;
+        }
+    }
+    int status = pclose(pipe);
+    if (status != 0 || bench_line.empty()) {
+        std::cerr << "  failed (exit status " << status << ")" << std::endl;
+        return false;
+    }
+
+    std::map<std::string, std::string> fields = parse_bench_line(bench_line);
+    result.program = program.substr(program.find_last_of('/') + 1);
+    result.mode = fields["mode"];
+    result.args = args;
+    result.size = fields["size"];
+    result.ranks = std::atoi(fields["ranks"].c_str());
+    result.best = std::atof(fields["best_s"].c_str());
+    result.mean = std::atof(fields["mean_s"].c_str());
+    result.bytes_max = std::atoll(fields["bytes_max"].c_str());
+    result.bytes_total = std::atoll(fields["bytes_total"].c_str());
+    result.messages_total = std::atoll(fields["messages_total"].c_str());
+    result.bytes_per_rank = fields["bytes_per_rank"];
+    return true;
+}
+
+// Speedup and efficiency are relative to the fewest ranks that ran the same
+// program, mode and arguments.
+static void add_scaling(std::vector<Result>& results) {
+    for (Result& result : results) {
+        const Result* base = &result;
+        for (const Result& other : results) {
+            if (other.program == result.program && other.mode == result.mode && other.args == result.args &&
+                other.ranks < base->ranks) {
+                base = &other;
+            }
+        }
+        result.speedup = base->best / result.best;
+        result.efficiency = result.speedup * base->ranks / result.ranks;
+    }
+}
+
+static void write_csv(const std::string& path, const std::vector<Result>& results) {
+    std::ofstream out(path);
+    out << "program,mode,args,size,ranks,best_s,mean_s,speedup,efficiency,"
+           "bytes_max,bytes_total,messages_total,bytes_per_rank\n";
+    for (const Result& r : results) {
+        out << r.program << "," << r.mode << ",\"" << r.args << "\"," << r.size << "," << r.ranks << ","
+            << r.best << "," << r.mean << "," << r.speedup << "," << r.efficiency << "," << r.bytes_max << ","
+            << r.bytes_total << "," << r.messages_total << "," << r.bytes_per_rank << "\n";
+    }
+}
+
+static void write_json(const std::string& path, const std::vector<Result>& results) {
+    std::ofstream out(path);
+    out << "[\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        std::string per_rank = r.bytes_per_rank;
+        for (char& c : per_rank) {
+            if (c == ';') {
+                c = ',';
+            }
+        }
+        out << "  {\"program\": \"" << r.program << "\", \"mode\": \"" << r.mode << "\", \"args\": \"" << r.args
+            << "\", \"size\": \"" << r.size << "\", \"ranks\": " << r.ranks << ", \"best_s\": " << r.best
+            << ", \"mean_s\": " << r.mean << ", \"speedup\": " << r.speedup << ", \"efficiency\": "
+            << r.efficiency << ", \"bytes_max\": " << r.bytes_max << ", \"bytes_total\": " << r.bytes_total
+            << ", \"messages_total\": " << r.messages_total << ", \"bytes_per_rank\": [" << per_rank << "]}"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "]\n";
+}
+
+int main(int argc, char** argv) {
+    HarnessOptions options;
+    if (!parse_options(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0] << " [quick=0|1] [ranks=1,2,4] [warmup=W] [reps=R] [only=TEXT]\n"
+                  << "       [launcher=\"mpirun --oversubscribe\"] [out=build/bench]\n";
+        return 1;
+    }
+
+    std::vector<Result> results;
+    int failures = 0;
+    for (const Sweep& sweep : default_sweeps(options)) {
+        for (const std::string& size : sweep.sizes) {
+            std::string args = substitute(sweep.args, size);
+            if (!options.only.empty() && (sweep.program + " " + args).find(options.only) == std::string::npos) {
+                continue;
+            }
+            for (int ranks : sweep.ranks) {
+                Result result;
+                if (run_one(options, sweep.program, args, ranks, result)) {
+                    results.push_back(result);
+                } else {
+                    failures++;
+                }
+            }
+        }
+    }
+    add_scaling(results);
+
+    write_csv(options.out + ".csv", results);
+    write_json(options.out + ".json", results);
+
+    std::printf("%-20s %-16s %-36s %5s %12s %8s %6s %14s\n",
+                "program", "mode", "args", "ranks", "best_s", "speedup", "eff", "bytes_max");
+    for (const Result& r : results) {
+        std::printf("%-20s %-16s %-36s %5d %12.6f %8.2f %6.2f %14lld\n", r.program.c_str(), r.mode.c_str(),
+                    r.args.c_str(), r.ranks, r.best, r.speedup, r.efficiency, r.bytes_max);
+    }
+    std::cout << results.size() << " runs written to " << options.out << ".csv and " << options.out << ".json";
+    if (failures > 0) {
+        std::cout << ", " << failures << " failed";
+    }
+    std::cout << std::endl;
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,268 @@
+#include "comm_volume.h"
+#include <mpi.h>
+
+// make PROFILE=1 adds per-call timing and the peer matrix to these wrappers
+#ifdef MPI_PROFILE
+#include "mpi_profile.h"
+#define PROFILE_SCOPE(call) ProfileScope profile_scope(call)
+#else
+#define PROFILE_SCOPE(call)
+#endif
+
+static CommVolume totals;
+
+CommVolume comm_volume() {
+    return totals;
+}
+
+static int rank_in(MPI_Comm comm) {
+    int rank;
+    PMPI_Comm_rank(comm, &rank);
+    return rank;
+}
+
+static int size_of(MPI_Comm comm) {
+    int size;
+    PMPI_Comm_size(comm, &size);
+    return size;
+}
+
+// One message of items to peer, a rank of comm
+static void count(int items, MPI_Datatype type, int peer, MPI_Comm comm) {
+    int type_size;
+    PMPI_Type_size(type, &type_size);
+    long long bytes = static_cast<long long>(items) * type_size;
+    totals.bytes += bytes;
+    totals.messages++;
+#ifdef MPI_PROFILE
+    profile_sent(comm, peer, bytes);
+#else
+    (void)peer;
+    (void)comm;
+#endif
+}
+
+// The same items to each other rank of comm
+static void count_others(int items, MPI_Datatype type, MPI_Comm comm) {
+    int rank = rank_in(comm), size = size_of(comm);
+    for (int r = 0; r < size; r++) {
+        if (r != rank) {
+            count(items, type, r, comm);
+        }
+    }
+}
+
+// Sum of the counts sent to the other ranks, skipping the caller's own share
+static void count_vector(const int counts[], MPI_Datatype type, MPI_Comm comm) {
+    int rank = rank_in(comm), size = size_of(comm);
+    for (int r = 0; r < size; r++) {
+        if (r != rank && counts[r] > 0) {
+            count(counts[r], type, r, comm);
+        }
+    }
+}
+
+extern "C" {
+
+int MPI_Send(const void* buf, int n, MPI_Datatype type, int dest, int tag, MPI_Comm comm) {
+    PROFILE_SCOPE(PROFILE_SEND);
+    if (dest != MPI_PROC_NULL) {
+        count(n, type, dest, comm);
+    }
+    return PMPI_Send(buf, n, type, dest, tag, comm);
+}
+
+int MPI_Ssend(const void* buf, int n, MPI_Datatype type, int dest, int tag, MPI_Comm comm) {
+    PROFILE_SCOPE(PROFILE_SSEND);
+    if (dest != MPI_PROC_NULL) {
+        count(n, type, dest, comm);
+    }
+    return PMPI_Ssend(buf, n, type, dest, tag, comm);
+}
+
+int MPI_Isend(const void* buf, int n, MPI_Datatype type, int dest, int tag, MPI_Comm comm, MPI_Request* request) {
+    PROFILE_SCOPE(PROFILE_ISEND);
+    if (dest != MPI_PROC_NULL) {
+        count(n, type, dest, comm);
+    }
+    return PMPI_Isend(buf, n, type, dest, tag, comm, request);
+}
+
+int MPI_Sendrecv(const void* sendbuf, int sendcount, MPI_Datatype sendtype, int dest, int sendtag,
+                 void* recvbuf, int recvcount, MPI_Datatype recvtype, int source, int recvtag,
+                 MPI_Comm comm, MPI_Status* status) {
+    PROFILE_SCOPE(PROFILE_SENDRECV);
+    if (dest != MPI_PROC_NULL) {
+        count(sendcount, sendtype, dest, comm);
+    }
+    return PMPI_Sendrecv(sendbuf, sendcount, sendtype, dest, sendtag,
+                         recvbuf, recvcount, recvtype, source, recvtag, comm, status);
+}
+
+int MPI_Sendrecv_replace(void* buf, int n, MPI_Datatype type, int dest, int sendtag,
+                         int source, int recvtag, MPI_Comm comm, MPI_Status* status) {
+    PROFILE_SCOPE(PROFILE_SENDRECV_REPLACE);
+    if (dest != MPI_PROC_NULL) {
+        count(n, type, dest, comm);
+    }
+    return PMPI_Sendrecv_replace(buf, n, type, dest, sendtag, source, recvtag, comm, status);
+}
+
+int MPI_Bcast(void* buf, int n, MPI_Datatype type, int root, MPI_Comm comm) {
+    PROFILE_SCOPE(PROFILE_BCAST);
+    if (rank_in(comm) == root) {
+        count_others(n, type, comm);
+    }
+    return PMPI_Bcast(buf, n, type, root, comm);
+}
+
+int MPI_Ibcast(void* buf, int n, MPI_Datatype type, int root, MPI_Comm comm, MPI_Request* request) {
+    PROFILE_SCOPE(PROFILE_IBCAST);
+    if (rank_in(comm) == root) {
+        count_others(n, type, comm);
+    }
+    return PMPI_Ibcast(buf, n, type, root, comm, request);
+}
+
+int MPI_Scatter(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, int recvcount,
+                MPI_Datatype recvtype, int root, MPI_Comm comm) {
+    PROFILE_SCOPE(PROFILE_SCATTER);
+    if (rank_in(comm) == root) {
+        count_others(sendcount, sendtype, comm);
+    }
+    return PMPI_Scatter(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, root, comm);
+}
+
+int MPI_Scatterv(const void* sendbuf, const int sendcounts[], const int displs[], MPI_Datatype sendtype,
+                 void* recvbuf, int recvcount, MPI_Datatype recvtype, int root, MPI_Comm comm) {
+    PROFILE_SCOPE(PROFILE_SCATTERV);
+    if (rank_in(comm) == root) {
+        count_vector(sendcounts, sendtype, comm);
+    }
+    return PMPI_Scatterv(sendbuf, sendcounts, displs, sendtype, recvbuf, recvcount, recvtype, root, comm);
+}
+
+int MPI_Gather(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, int recvcount,
+               MPI_Datatype recvtype, int root, MPI_Comm comm) {
+    PROFILE_SCOPE(PROFILE_GATHER);
+    if (rank_in(comm) != root) {
+        count(sendcount, sendtype, root, comm);
+    }
+    return PMPI_Gather(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, root, comm);
+}
+
+int MPI_Gatherv(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf,
+                const int recvcounts[], const int displs[], MPI_Datatype recvtype, int root, MPI_Comm comm) {
+    PROFILE_SCOPE(PROFILE_GATHERV);
+    if (rank_in(comm) != root) {
+        count(sendcount, sendtype, root, comm);
+    }
+    return PMPI_Gatherv(sendbuf, sendcount, sendtype, recvbuf, recvcounts, displs, recvtype, root, comm);
+}
+
+int MPI_Allgather(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, int recvcount,
+                  MPI_Datatype recvtype, MPI_Comm comm) {
+    PROFILE_SCOPE(PROFILE_ALLGATHER);
+    if (sendbuf == MPI_IN_PLACE) {
+        count_others(recvcount, recvtype, comm);
+    } else {
+        count_others(sendcount, sendtype, comm);
+    }
+    return PMPI_Allgather(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, comm);
+}
+
+int MPI_Alltoall(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, int recvcount,
+                 MPI_Datatype recvtype, MPI_Comm comm) {
+    PROFILE_SCOPE(PROFILE_ALLTOALL);
+    count_others(sendcount, sendtype, comm);
+    return PMPI_Alltoall(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, comm);
+}
+
+int MPI_Alltoallv(const void* sendbuf, const int sendcounts[], const int sdispls[], MPI_Datatype sendtype,
+                  void* recvbuf, const int recvcounts[], const int rdispls[], MPI_Datatype recvtype,
+                  MPI_Comm comm) {
+    PROFILE_SCOPE(PROFILE_ALLTOALLV);
+    count_vector(sendcounts, sendtype, comm);
+    return PMPI_Alltoallv(sendbuf, sendcounts, sdispls, sendtype, recvbuf, recvcounts, rdispls, recvtype, comm);
+}
+
+int MPI_Reduce(const void* sendbuf, void* recvbuf, int n, MPI_Datatype type, MPI_Op op, int root, MPI_Comm comm) {
+    PROFILE_SCOPE(PROFILE_REDUCE);
+    if (rank_in(comm) != root) {
+        count(n, type, root, comm);
+    }
+    return PMPI_Reduce(sendbuf, recvbuf, n, type, op, root, comm);
+}
+
+int MPI_Allreduce(const void* sendbuf, void* recvbuf, int n, MPI_Datatype type, MPI_Op op, MPI_Comm comm) {
+    PROFILE_SCOPE(PROFILE_ALLREDUCE);
+    if (size_of(comm) > 1) {
+        count(n, type, MPI_PROC_NULL, comm);
+    }
+    return PMPI_Allreduce(sendbuf, recvbuf, n, type, op, comm);
+}
+
+#ifdef MPI_PROFILE
+
+// Calls that send no payload are only wrapped when profiling
+
+int MPI_Init(int* argc, char*** argv) {
+    int result = PMPI_Init(argc, argv);
+    profile_start();
+    return result;
+}
+
+int MPI_Init_thread(int* argc, char*** argv, int required, int* provided) {
+    int result = PMPI_Init_thread(argc, argv, required, provided);
+    profile_start();
+    return result;
+}
+
+int MPI_Finalize() {
+    profile_report();
+    return PMPI_Finalize();
+}
+
+int MPI_Comm_free(MPI_Comm* comm) {
+    profile_forget(*comm);
+    return PMPI_Comm_free(comm);
+}
+
+int MPI_Recv(void* buf, int n, MPI_Datatype type, int source, int tag, MPI_Comm comm, MPI_Status* status) {
+    PROFILE_SCOPE(PROFILE_RECV);
+    MPI_Status local;
+    MPI_Status* used = status == MPI_STATUS_IGNORE ? &local : status;
+    int result = PMPI_Recv(buf, n, type, source, tag, comm, used);
+    int received;
+    if (source != MPI_PROC_NULL && PMPI_Get_count(used, type, &received) == MPI_SUCCESS &&
+        received != MPI_UNDEFINED) {
+        int type_size;
+        PMPI_Type_size(type, &type_size);
+        profile_received(static_cast<long long>(received) * type_size);
+    }
+    return result;
+}
+
+int MPI_Irecv(void* buf, int n, MPI_Datatype type, int source, int tag, MPI_Comm comm, MPI_Request* request) {
+    PROFILE_SCOPE(PROFILE_IRECV);
+    if (source != MPI_PROC_NULL) {
+        int type_size;
+        PMPI_Type_size(type, &type_size);
+        profile_received(static_cast<long long>(n) * type_size);
+    }
+    return PMPI_Irecv(buf, n, type, source, tag, comm, request);
+}
+
+int MPI_Wait(MPI_Request* request, MPI_Status* status) {
+    PROFILE_SCOPE(PROFILE_WAIT);
+    return PMPI_Wait(request, status);
+}
+
+int MPI_Barrier(MPI_Comm comm) {
+    PROFILE_SCOPE(PROFILE_BARRIER);
+    return PMPI_Barrier(comm);
+}
+
+#endif
+
+}
@@ -0,0 +1,16 @@
+#ifndef COMM_VOLUME_H
+#define COMM_VOLUME_H
+
+// Running totals of the data this rank has sent since MPI_Init, collected
+// by PMPI wrappers around the point-to-point and collective calls the labs
+// use. Collectives count the payload that must leave this rank whatever
+// algorithm the library picks: a broadcast root sends count to each other
+// rank, a gather contributor sends its part once, and so on.
+struct CommVolume {
+    long long bytes = 0;
+    long long messages = 0;
+};
+
+CommVolume comm_volume();
+
+#endif // COMM_VOLUME_H
@@ -0,0 +1,72 @@
+# Sources shared by the lab programs. Include after setting COMMON_BUILD to
+# the directory the objects should go to; CXX and CXXFLAGS come from the
+# including Makefile.
+
+COMMON_DIR := $(dir $(lastword $(MAKEFILE_LIST)))
+CXXFLAGS += -I$(COMMON_DIR)
+
+KERNEL_FLAGS = -O3 -ffp-contract=fast
+KERNEL_HEADERS = $(COMMON_DIR)gemm_kernel.h $(COMMON_DIR)gemm_kernel_impl.h
+KERNEL_OBJS = $(COMMON_BUILD)/gemm_kernel.o $(COMMON_BUILD)/gemm_kernel_generic.o
+
+# The wider micro-kernels are only built for x86-64 and picked at runtime
+ifeq ($(shell uname -m),x86_64)
+KERNEL_FLAGS += -DGEMM_KERNEL_X86
+KERNEL_OBJS += $(COMMON_BUILD)/gemm_kernel_avx2.o $(COMMON_BUILD)/gemm_kernel_avx512.o
+endif
+
+$(COMMON_BUILD)/gemm_kernel.o: $(COMMON_DIR)gemm_kernel.cpp $(KERNEL_HEADERS)
+	$(CXX) $(CXXFLAGS) $(KERNEL_FLAGS) -c $< -o $@
+
+$(COMMON_BUILD)/gemm_kernel_generic.o: $(COMMON_DIR)gemm_kernel_generic.cpp $(KERNEL_HEADERS)
+	$(CXX) $(CXXFLAGS) $(KERNEL_FLAGS) -c $< -o $@
+
+$(COMMON_BUILD)/gemm_kernel_avx2.o: $(COMMON_DIR)gemm_kernel_avx2.cpp $(KERNEL_HEADERS)
+	$(CXX) $(CXXFLAGS) $(KERNEL_FLAGS) -mavx2 -mfma -c $< -o $@
+
+$(COMMON_BUILD)/gemm_kernel_avx512.o: $(COMMON_DIR)gemm_kernel_avx512.cpp $(KERNEL_HEADERS)
+	$(CXX) $(CXXFLAGS) $(KERNEL_FLAGS) -mavx512f -mavx512bw -c $< -o $@
+
+POOL_HEADERS = $(COMMON_DIR)thread_pool.h
+POOL_OBJS = $(COMMON_BUILD)/thread_pool.o
+
+$(COMMON_BUILD)/thread_pool.o: $(COMMON_DIR)thread_pool.cpp $(POOL_HEADERS)
+	$(CXX) $(CXXFLAGS) -pthread -c $< -o $@
+
+# Repetition timing and per-rank traffic for the benchmark harness. The
+# traffic counters are PMPI wrappers, so they take effect by being linked.
+# PROFILE=1 builds them with per-call timing and a peer matrix reported at
+# MPI_Finalize (see mpi_profile.h). The stamp file holds the last setting so
+# that switching it rebuilds the wrappers and relinks the programs.
+BENCH_HEADERS = $(COMMON_DIR)bench.h $(COMMON_DIR)comm_volume.h
+BENCH_OBJS = $(COMMON_BUILD)/bench.o $(COMMON_BUILD)/comm_volume.o $(COMMON_BUILD)/mpi_profile.o
+
+PROFILE ?= 0
+PROFILE_STAMP = $(COMMON_BUILD)/.profile
+$(shell mkdir -p $(COMMON_BUILD); echo "$(PROFILE)" | cmp -s - $(PROFILE_STAMP) || echo "$(PROFILE)" > $(PROFILE_STAMP))
+ifeq ($(PROFILE),1)
+PROFILE_FLAGS = -DMPI_PROFILE
+endif
+
+$(COMMON_BUILD)/bench.o: $(COMMON_DIR)bench.cpp $(BENCH_HEADERS)
+	$(CXX) $(CXXFLAGS) -c $< -o $@
+
+$(COMMON_BUILD)/comm_volume.o: $(COMMON_DIR)comm_volume.cpp $(COMMON_DIR)comm_volume.h $(COMMON_DIR)mpi_profile.h $(PROFILE_STAMP)
+	$(CXX) $(CXXFLAGS) $(PROFILE_FLAGS) -c $< -o $@
+
+$(COMMON_BUILD)/mpi_profile.o: $(COMMON_DIR)mpi_profile.cpp $(COMMON_DIR)mpi_profile.h
+	$(CXX) $(CXXFLAGS) -c $< -o $@
+
+# Node layout and the communicators built from it, cached per process
+TOPOLOGY_HEADERS = $(COMMON_DIR)topology.h
+TOPOLOGY_OBJS = $(COMMON_BUILD)/topology.o
+
+$(COMMON_BUILD)/topology.o: $(COMMON_DIR)topology.cpp $(TOPOLOGY_HEADERS)
+	$(CXX) $(CXXFLAGS) -c $< -o $@
+
+# Binary matrix files read and written collectively with MPI-IO
+MATRIX_IO_HEADERS = $(COMMON_DIR)matrix_io.h
+MATRIX_IO_OBJS = $(COMMON_BUILD)/matrix_io.o
+
+$(COMMON_BUILD)/matrix_io.o: $(COMMON_DIR)matrix_io.cpp $(MATRIX_IO_HEADERS)
+	$(CXX) $(CXXFLAGS) -c $< -o $@
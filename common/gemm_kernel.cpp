@@ -0,0 +1,190 @@
+#include "gemm_kernel.h"
+#include "gemm_kernel_impl.h"
+#include <cstdlib>
+#include <cstring>
+
+static KernelIsa detect_isa() {
+    KernelIsa isa = KernelIsa::Generic;
+    if (kernel_isa_supported(KernelIsa::Avx512)) {
+        isa = KernelIsa::Avx512;
+    } else if (kernel_isa_supported(KernelIsa::Avx2)) {
+        isa = KernelIsa::Avx2;
+    }
+
+    const char* forced = std::getenv("GEMM_KERNEL_ISA");
+    if (forced != nullptr) {
+        for (KernelIsa candidate : {KernelIsa::Generic, KernelIsa::Avx2, KernelIsa::Avx512}) {
+            if (std::strcmp(forced, kernel_isa_name(candidate)) == 0 && kernel_isa_supported(candidate)) {
+                isa = candidate;
+            }
+        }
+    }
+    return isa;
+}
+
+static KernelIsa& current_isa() {
+    static KernelIsa isa = detect_isa();
+    return isa;
+}
+
+KernelIsa kernel_isa() {
+    return current_isa();
+}
+
+void set_kernel_isa(KernelIsa isa) {
+    if (kernel_isa_supported(isa)) {
+        current_isa() = isa;
+    }
+}
+
+bool kernel_isa_supported(KernelIsa isa) {
+    switch (isa) {
+#ifdef GEMM_KERNEL_X86
+        case KernelIsa::Avx512:
+            return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+        case KernelIsa::Avx2:
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+        case KernelIsa::Generic:
+            return true;
+        default:
+            return false;
+    }
+}
+
+const char* kernel_isa_name(KernelIsa isa) {
+    switch (isa) {
+        case KernelIsa::Avx512: return "avx512";
+        case KernelIsa::Avx2: return "avx2";
+        default: return "generic";
+    }
+}
+
+template<typename T>
+void local_gemm(int m, int n, int k, const T* A, int lda, const T* B, int ldb, T* C, int ldc) {
+    if (m <= 0 || n <= 0 || k <= 0) {
+        return;
+    }
+    switch (kernel_isa()) {
+#ifdef GEMM_KERNEL_X86
+        case KernelIsa::Avx512:
+            gemm_avx512(m, n, k, A, lda, B, ldb, C, ldc);
+            break;
+        case KernelIsa::Avx2:
+            gemm_avx2(m, n, k, A, lda, B, ldb, C, ldc);
+            break;
+#endif
+        default:
+            gemm_generic(m, n, k, A, lda, B, ldb, C, ldc);
+            break;
+    }
+}
+
+template<typename T>
+static void narrow_gemm(int m, int n, int k, const T* A, int lda, const T* B, int ldb, int32_t* C, int ldc) {
+    if (m <= 0 || n <= 0 || k <= 0) {
+        return;
+    }
+    switch (kernel_isa()) {
+#ifdef GEMM_KERNEL_X86
+        case KernelIsa::Avx512:
+            gemm_avx512(m, n, k, A, lda, B, ldb, C, ldc);
+            break;
+        case KernelIsa::Avx2:
+            gemm_avx2(m, n, k, A, lda, B, ldb, C, ldc);
+            break;
+#endif
+        default:
+            gemm_generic(m, n, k, A, lda, B, ldb, C, ldc);
+            break;
+    }
+}
+
+void local_gemm(int m, int n, int k, const int8_t* A, int lda, const int8_t* B, int ldb, int32_t* C, int ldc) {
+    narrow_gemm(m, n, k, A, lda, B, ldb, C, ldc);
+}
+
+void local_gemm(int m, int n, int k, const int16_t* A, int lda, const int16_t* B, int ldb, int32_t* C, int ldc) {
+    narrow_gemm(m, n, k, A, lda, B, ldb, C, ldc);
+}
+
+template<typename T>
+void local_gemv(int m, int n, const T* A, int lda, const T* x, T* y) {
+    if (m <= 0 || n <= 0) {
+        return;
+    }
+    switch (kernel_isa()) {
+#ifdef GEMM_KERNEL_X86
+        case KernelIsa::Avx512:
+            gemv_avx512(m, n, A, lda, x, y);
+            break;
+        case KernelIsa::Avx2:
+            gemv_avx2(m, n, A, lda, x, y);
+            break;
+#endif
+        default:
+            gemv_generic(m, n, A, lda, x, y);
+            break;
+    }
+}
+
+template<typename T>
+void naive_gemm(int m, int n, int k, const T* A, int lda, const T* B, int ldb, T* C, int ldc) {
+    for (int i = 0; i < m; i++) {
+        for (int j = 0; j < n; j++) {
+            T sum = 0;
+            for (int p = 0; p < k; p++) {
+                sum += A[static_cast<size_t>(i) * lda + p] * B[static_cast<size_t>(p) * ldb + j];
+            }
+            C[static_cast<size_t>(i) * ldc + j] += sum;
+        }
+    }
+}
+
+template<typename T>
+void naive_gemv(int m, int n, const T* A, int lda, const T* x, T* y) {
+    for (int i = 0; i < m; i++) {
+        T sum = 0;
+        for (int j = 0; j < n; j++) {
+            sum += A[static_cast<size_t>(i) * lda + j] * x[j];
+        }
+        y[i] += sum;
+    }
+}
+
+template<int M, int K, int N, typename T>
+void batched_gemm(int count, const T* A, const T* B, T* C) {
+    if (count <= 0) {
+        return;
+    }
+    switch (kernel_isa()) {
+#ifdef GEMM_KERNEL_X86
+        case KernelIsa::Avx512:
+            batched_gemm_avx512<M, K, N, T>(count, A, B, C);
+            break;
+        case KernelIsa::Avx2:
+            batched_gemm_avx2<M, K, N, T>(count, A, B, C);
+            break;
+#endif
+        default:
+            batched_gemm_generic<M, K, N, T>(count, A, B, C);
+            break;
+    }
+}
+
+#define GEMM_KERNEL_INSTANTIATE(T)                                                          \
+    template void local_gemm<T>(int, int, int, const T*, int, const T*, int, T*, int);     \
+    template void local_gemv<T>(int, int, const T*, int, const T*, T*);                    \
+    template void naive_gemm<T>(int, int, int, const T*, int, const T*, int, T*, int);     \
+    template void naive_gemv<T>(int, int, const T*, int, const T*, T*);
+
+GEMM_KERNEL_INSTANTIATE(int32_t)
+GEMM_KERNEL_INSTANTIATE(float)
+GEMM_KERNEL_INSTANTIATE(double)
+
+#define BATCHED_GEMM_INSTANTIATE_DISPATCH(unused, M, K, N)                                   \
+    template void batched_gemm<M, K, N, int32_t>(int, const int32_t*, const int32_t*, int32_t*); \
+    template void batched_gemm<M, K, N, float>(int, const float*, const float*, float*);     \
+    template void batched_gemm<M, K, N, double>(int, const double*, const double*, double*);
+
+BATCHED_GEMM_SHAPES(BATCHED_GEMM_INSTANTIATE_DISPATCH, _)
@@ -0,0 +1,83 @@
+#ifndef GEMM_KERNEL_H
+#define GEMM_KERNEL_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Local dense kernels shared by the distributed matrix programs. All
+// matrices are row-major with explicit leading dimensions. Instantiated
+// for int32_t, float and double.
+//
+// The blocked kernels pack A into MR-row and B into NR-column panels sized
+// for L2 and L1, then run a register-blocked MR x NR micro-kernel. The
+// micro-kernel is compiled once per instruction set and the widest one the
+// CPU supports is picked at runtime (GEMM_KERNEL_ISA=generic|avx2|avx512
+// overrides the choice).
+
+enum class KernelIsa {
+    Generic, // Baseline vector width of the target (SSE2 on x86-64)
+    Avx2,
+    Avx512
+};
+
+KernelIsa kernel_isa();
+void set_kernel_isa(KernelIsa isa);
+bool kernel_isa_supported(KernelIsa isa);
+const char* kernel_isa_name(KernelIsa isa);
+
+// C[m x n] += A[m x k] * B[k x n]
+template<typename T>
+void local_gemm(int m, int n, int k, const T* A, int lda, const T* B, int ldb, T* C, int ldc);
+
+// C[m x n] += A[m x k] * B[k x n] for narrow integer operands with int32_t
+// accumulation. Pairs of K values are multiplied and summed in one widening
+// step (pmaddwd; int8_t is widened to int16_t while packing), so C is
+// exactly what the int32_t kernel gives for the same values.
+void local_gemm(int m, int n, int k, const int8_t* A, int lda, const int8_t* B, int ldb, int32_t* C, int ldc);
+void local_gemm(int m, int n, int k, const int16_t* A, int lda, const int16_t* B, int ldb, int32_t* C, int ldc);
+
+// y[m] += A[m x n] * x[n]
+template<typename T>
+void local_gemv(int m, int n, const T* A, int lda, const T* x, T* y);
+
+// Textbook triple loop, the baseline the benchmark compares against
+template<typename T>
+void naive_gemm(int m, int n, int k, const T* A, int lda, const T* B, int ldb, T* C, int ldc);
+
+template<typename T>
+void naive_gemv(int m, int n, const T* A, int lda, const T* x, T* y);
+
+// Shapes the batched kernel is compiled for, as X(arg, M, K, N). Add a
+// line here to get another one.
+#define BATCHED_GEMM_SHAPES(X, arg) \
+    X(arg, 2, 2, 2)                 \
+    X(arg, 3, 3, 3)                 \
+    X(arg, 4, 4, 4)                 \
+    X(arg, 4, 5, 6)                 \
+    X(arg, 8, 8, 8)
+
+// Batches are stored in slices of BATCHED_GEMM_SLICE matrices, each slice
+// in structure-of-arrays layout: element e of matrix b sits at
+// batched_index(elements, b, e), so every element forms a run over the
+// slice. Buffers are rounded up to whole slices.
+const int BATCHED_GEMM_SLICE = 64;
+
+inline size_t batched_index(int elements, long long b, int e) {
+    return static_cast<size_t>(b / BATCHED_GEMM_SLICE) * elements * BATCHED_GEMM_SLICE +
+           static_cast<size_t>(e) * BATCHED_GEMM_SLICE + b % BATCHED_GEMM_SLICE;
+}
+
+inline size_t batched_size(int elements, long long count) {
+    return batched_index(elements, count + BATCHED_GEMM_SLICE - 1, 0) / BATCHED_GEMM_SLICE * BATCHED_GEMM_SLICE;
+}
+
+// count independent products C_b[M x N] = A_b[M x K] * B_b[K x N] in the
+// sliced layout above. The kernel multiplies a vector of matrices at a time
+// with the M x K x N loops unrolled at compile time, and with the slice
+// width fixed every element is a constant offset from the slice start.
+// A part of a batch starting at a slice boundary is the same call with the
+// pointers offset to that slice.
+template<int M, int K, int N, typename T>
+void batched_gemm(int count, const T* A, const T* B, T* C);
+
+#endif // GEMM_KERNEL_H
@@ -0,0 +1,4 @@
+// Built with -mavx2 -mfma, only called after a runtime CPU check
+#include "gemm_kernel_impl.h"
+
+GEMM_KERNEL_DEFINE_ISA(avx2, 32)
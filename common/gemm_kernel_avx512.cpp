@@ -0,0 +1,4 @@
+// Built with -mavx512f -mavx512bw, only called after a runtime CPU check
+#include "gemm_kernel_impl.h"
+
+GEMM_KERNEL_DEFINE_ISA(avx512, 64)
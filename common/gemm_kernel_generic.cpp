@@ -0,0 +1,4 @@
+// Built with the default flags of the target
+#include "gemm_kernel_impl.h"
+
+GEMM_KERNEL_DEFINE_ISA(generic, 16)
@@ -0,0 +1,460 @@
+#ifndef GEMM_KERNEL_IMPL_H
+#define GEMM_KERNEL_IMPL_H
+
+// Blocked GEMM/GEMV templates, included by one translation unit per
+// instruction set. Everything lives in an anonymous namespace so the
+// copies compiled with different -m flags never get merged by the linker.
+
+#include "gemm_kernel.h"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// Per-ISA entry points, defined in gemm_kernel_<isa>.cpp
+#define GEMM_KERNEL_DECLARE_ISA(isa)                                                                 \
+    void gemm_##isa(int m, int n, int k, const int32_t* A, int lda, const int32_t* B, int ldb,      \
+                    int32_t* C, int ldc);                                                            \
+    void gemm_##isa(int m, int n, int k, const float* A, int lda, const float* B, int ldb,          \
+                    float* C, int ldc);                                                              \
+    void gemm_##isa(int m, int n, int k, const double* A, int lda, const double* B, int ldb,        \
+                    double* C, int ldc);                                                             \
+    void gemm_##isa(int m, int n, int k, const int8_t* A, int lda, const int8_t* B, int ldb,        \
+                    int32_t* C, int ldc);                                                            \
+    void gemm_##isa(int m, int n, int k, const int16_t* A, int lda, const int16_t* B, int ldb,      \
+                    int32_t* C, int ldc);                                                            \
+    void gemv_##isa(int m, int n, const int32_t* A, int lda, const int32_t* x, int32_t* y);         \
+    void gemv_##isa(int m, int n, const float* A, int lda, const float* x, float* y);               \
+    void gemv_##isa(int m, int n, const double* A, int lda, const double* x, double* y);             \
+    template<int M, int K, int N, typename T>                                                        \
+    void batched_gemm_##isa(int count, const T* A, const T* B, T* C);
+
+GEMM_KERNEL_DECLARE_ISA(generic)
+GEMM_KERNEL_DECLARE_ISA(avx2)
+GEMM_KERNEL_DECLARE_ISA(avx512)
+
+namespace {
+
+template<typename T, int VB>
+struct Vec {
+    typedef T type __attribute__((vector_size(VB)));
+    static const int LANES = VB / sizeof(T);
+};
+
+// Register block: MR rows of A times NV vectors of B. With 6 x 2 the
+// accumulators take 12 registers, which fits both 16-register (SSE/AVX2)
+// and 32-register (AVX-512) files with room for the B loads.
+const int MR = 6;
+const int NV = 2;
+
+// Cache blocks: a KC x NR sliver of B stays in L1, the MC x KC block of A
+// in L2 and the KC x NC panel of B in L3.
+const int KC = 256;
+const int MC = 96;
+const int NC = 4096;
+
+template<typename V>
+inline V load_vec(const void* p) {
+    V v;
+    __builtin_memcpy(&v, p, sizeof(V));
+    return v;
+}
+
+template<typename V>
+inline void store_vec(void* p, const V& v) {
+    __builtin_memcpy(p, &v, sizeof(V));
+}
+
+// A block [mc x kc] -> MR-row slivers, column by column, zero padded
+template<typename T>
+inline void pack_a(int mc, int kc, const T* A, int lda, T* packed) {
+    for (int i0 = 0; i0 < mc; i0 += MR) {
+        int rows = std::min(MR, mc - i0);
+        for (int p = 0; p < kc; p++) {
+            for (int i = 0; i < MR; i++) {
+                *packed++ = i < rows ? A[static_cast<size_t>(i0 + i) * lda + p] : T(0);
+            }
+        }
+    }
+}
+
+// B panel [kc x nc] -> NR-column slivers, row by row, zero padded
+template<typename T, int NR>
+inline void pack_b(int kc, int nc, const T* B, int ldb, T* packed) {
+    for (int j0 = 0; j0 < nc; j0 += NR) {
+        int cols = std::min(NR, nc - j0);
+        for (int p = 0; p < kc; p++) {
+            const T* row = B + static_cast<size_t>(p) * ldb + j0;
+            for (int j = 0; j < NR; j++) {
+                *packed++ = j < cols ? row[j] : T(0);
+            }
+        }
+    }
+}
+
+// C[mr x nr] += the accumulated MR x NR block
+template<typename T, int VB>
+inline void add_tile(const typename Vec<T, VB>::type (&acc)[MR][NV], T* C, int ldc, int mr, int nr) {
+    typedef typename Vec<T, VB>::type V;
+    const int W = Vec<T, VB>::LANES;
+    const int NR = NV * W;
+
+    if (mr == MR && nr == NR) {
+        for (int i = 0; i < MR; i++) {
+            T* c = C + static_cast<size_t>(i) * ldc;
+            for (int v = 0; v < NV; v++) {
+                store_vec(c + v * W, load_vec<V>(c + v * W) + acc[i][v]);
+            }
+        }
+    } else {
+        T tile[MR][NR];
+        for (int i = 0; i < MR; i++) {
+            for (int v = 0; v < NV; v++) {
+                store_vec(&tile[i][v * W], acc[i][v]);
+            }
+        }
+        for (int i = 0; i < mr; i++) {
+            for (int j = 0; j < nr; j++) {
+                C[static_cast<size_t>(i) * ldc + j] += tile[i][j];
+            }
+        }
+    }
+}
+
+template<typename T, int VB>
+inline void micro_kernel(int kc, const T* a, const T* b, T* C, int ldc, int mr, int nr) {
+    typedef typename Vec<T, VB>::type V;
+    const int W = Vec<T, VB>::LANES;
+    const int NR = NV * W;
+
+    V acc[MR][NV];
+    for (int i = 0; i < MR; i++) {
+        for (int v = 0; v < NV; v++) {
+            acc[i][v] = V{};
+        }
+    }
+
+    for (int p = 0; p < kc; p++) {
+        V bv[NV];
+        for (int v = 0; v < NV; v++) {
+            bv[v] = load_vec<V>(b + v * W);
+        }
+        for (int i = 0; i < MR; i++) {
+            T ai = a[i];
+            for (int v = 0; v < NV; v++) {
+                acc[i][v] += ai * bv[v];
+            }
+        }
+        a += MR;
+        b += NR;
+    }
+
+    add_tile<T, VB>(acc, C, ldc, mr, nr);
+}
+
+// Pairs of adjacent int16 products summed into int32 lanes, as pmaddwd
+// does: lane l is a[2l] * b[2l] + a[2l + 1] * b[2l + 1]
+template<int VB>
+inline typename Vec<int32_t, VB>::type madd_pairs(typename Vec<int16_t, VB>::type a,
+                                                  typename Vec<int16_t, VB>::type b) {
+    typedef typename Vec<int32_t, VB>::type V;
+#if defined(__AVX512BW__)
+    if constexpr (VB == 64) {
+        return (V)_mm512_madd_epi16((__m512i)a, (__m512i)b);
+    }
+#endif
+#if defined(__AVX2__)
+    if constexpr (VB == 32) {
+        return (V)_mm256_madd_epi16((__m256i)a, (__m256i)b);
+    }
+#endif
+#if defined(__SSE2__)
+    if constexpr (VB == 16) {
+        return (V)_mm_madd_epi16((__m128i)a, (__m128i)b);
+    }
+#endif
+    V sum;
+    for (int l = 0; l < Vec<int32_t, VB>::LANES; l++) {
+        sum[l] = static_cast<int32_t>(int64_t(a[2 * l]) * b[2 * l] + int64_t(a[2 * l + 1]) * b[2 * l + 1]);
+    }
+    return sum;
+}
+
+// A block [mc x kc] -> MR-row slivers of K pairs: for each pair the two
+// values of every row side by side, widened to int16 and zero padded
+template<typename T>
+inline void pack_a_pairs(int mc, int kc, const T* A, int lda, int16_t* packed) {
+    for (int i0 = 0; i0 < mc; i0 += MR) {
+        int rows = std::min(MR, mc - i0);
+        for (int p = 0; p < kc; p += 2) {
+            for (int i = 0; i < MR; i++) {
+                const T* a = A + static_cast<size_t>(i0 + i) * lda + p;
+                *packed++ = i < rows ? a[0] : 0;
+                *packed++ = i < rows && p + 1 < kc ? a[1] : 0;
+            }
+        }
+    }
+}
+
+// B panel [kc x nc] -> NR-column slivers of K pairs: for each pair the two
+// values of every column side by side, widened to int16 and zero padded
+template<typename T, int NR>
+inline void pack_b_pairs(int kc, int nc, const T* B, int ldb, int16_t* packed) {
+    for (int j0 = 0; j0 < nc; j0 += NR) {
+        int cols = std::min(NR, nc - j0);
+        for (int p = 0; p < kc; p += 2) {
+            const T* row = B + static_cast<size_t>(p) * ldb + j0;
+            for (int j = 0; j < NR; j++) {
+                *packed++ = j < cols ? row[j] : 0;
+                *packed++ = j < cols && p + 1 < kc ? row[ldb + j] : 0;
+            }
+        }
+    }
+}
+
+// The MR x NR block of micro_kernel over K pairs: one widening
+// multiply-add per pair instead of two multiplies and two adds
+template<int VB>
+inline void micro_kernel_pairs(int pairs, const int16_t* a, const int16_t* b, int32_t* C, int ldc,
+                               int mr, int nr) {
+    typedef typename Vec<int32_t, VB>::type V;
+    typedef typename Vec<int16_t, VB>::type V16;
+    const int W = Vec<int32_t, VB>::LANES;
+    const int NR = NV * W;
+
+    V acc[MR][NV];
+    for (int i = 0; i < MR; i++) {
+        for (int v = 0; v < NV; v++) {
+            acc[i][v] = V{};
+        }
+    }
+
+    for (int q = 0; q < pairs; q++) {
+        V16 bv[NV];
+        for (int v = 0; v < NV; v++) {
+            bv[v] = load_vec<V16>(b + v * 2 * W);
+        }
+        for (int i = 0; i < MR; i++) {
+            int32_t pair;
+            __builtin_memcpy(&pair, a + 2 * i, sizeof(pair));
+            V16 ai = (V16)(V{} + pair);
+            for (int v = 0; v < NV; v++) {
+                acc[i][v] += madd_pairs<VB>(ai, bv[v]);
+            }
+        }
+        a += 2 * MR;
+        b += 2 * NR;
+    }
+
+    add_tile<int32_t, VB>(acc, C, ldc, mr, nr);
+}
+
+template<typename T, int VB>
+void gemm_blocked(int m, int n, int k, const T* A, int lda, const T* B, int ldb, T* C, int ldc) {
+    const int NR = NV * Vec<T, VB>::LANES;
+    // Per thread, so ranks running a thread pool can share the kernel
+    thread_local std::vector<T> packed_a, packed_b;
+
+    for (int jc = 0; jc < n; jc += NC) {
+        int nc = std::min(NC, n - jc);
+        for (int pc = 0; pc < k; pc += KC) {
+            int kc = std::min(KC, k - pc);
+            packed_b.resize(static_cast<size_t>(kc) * ((nc + NR - 1) / NR) * NR);
+            pack_b<T, NR>(kc, nc, B + static_cast<size_t>(pc) * ldb + jc, ldb, packed_b.data());
+
+            for (int ic = 0; ic < m; ic += MC) {
+                int mc = std::min(MC, m - ic);
+                packed_a.resize(static_cast<size_t>(kc) * ((mc + MR - 1) / MR) * MR);
+                pack_a(mc, kc, A + static_cast<size_t>(ic) * lda + pc, lda, packed_a.data());
+
+                for (int jr = 0; jr < nc; jr += NR) {
+                    for (int ir = 0; ir < mc; ir += MR) {
+                        micro_kernel<T, VB>(kc,
+                                            packed_a.data() + static_cast<size_t>(ir) * kc,
+                                            packed_b.data() + static_cast<size_t>(jr) * kc,
+                                            C + static_cast<size_t>(ic + ir) * ldc + jc + jr, ldc,
+                                            std::min(MR, mc - ir), std::min(NR, nc - jr));
+                    }
+                }
+            }
+        }
+    }
+}
+
+// gemm_blocked for narrow integer operands with int32 accumulation. KC is
+// even, so only the last K block can end in a half pair.
+template<typename T, int VB>
+void gemm_pairs(int m, int n, int k, const T* A, int lda, const T* B, int ldb, int32_t* C, int ldc) {
+    const int NR = NV * Vec<int32_t, VB>::LANES;
+    thread_local std::vector<int16_t> packed_a, packed_b;
+
+    for (int jc = 0; jc < n; jc += NC) {
+        int nc = std::min(NC, n - jc);
+        for (int pc = 0; pc < k; pc += KC) {
+            int kc = std::min(KC, k - pc);
+            int pairs = (kc + 1) / 2;
+            packed_b.resize(static_cast<size_t>(2 * pairs) * ((nc + NR - 1) / NR) * NR);
+            pack_b_pairs<T, NR>(kc, nc, B + static_cast<size_t>(pc) * ldb + jc, ldb, packed_b.data());
+
+            for (int ic = 0; ic < m; ic += MC) {
+                int mc = std::min(MC, m - ic);
+                packed_a.resize(static_cast<size_t>(2 * pairs) * ((mc + MR - 1) / MR) * MR);
+                pack_a_pairs(mc, kc, A + static_cast<size_t>(ic) * lda + pc, lda, packed_a.data());
+
+                for (int jr = 0; jr < nc; jr += NR) {
+                    for (int ir = 0; ir < mc; ir += MR) {
+                        micro_kernel_pairs<VB>(pairs,
+                                               packed_a.data() + static_cast<size_t>(ir) * 2 * pairs,
+                                               packed_b.data() + static_cast<size_t>(jr) * 2 * pairs,
+                                               C + static_cast<size_t>(ic + ir) * ldc + jc + jr, ldc,
+                                               std::min(MR, mc - ir), std::min(NR, nc - jr));
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Four rows at a time so every load of x feeds four accumulators
+template<typename T, int VB>
+void gemv_blocked(int m, int n, const T* A, int lda, const T* x, T* y) {
+    typedef typename Vec<T, VB>::type V;
+    const int W = Vec<T, VB>::LANES;
+    const int ROWS = 4;
+
+    int i = 0;
+    for (; i + ROWS <= m; i += ROWS) {
+        const T* a[ROWS];
+        V acc[ROWS];
+        for (int r = 0; r < ROWS; r++) {
+            a[r] = A + static_cast<size_t>(i + r) * lda;
+            acc[r] = V{};
+        }
+        int j = 0;
+        for (; j + W <= n; j += W) {
+            V xv = load_vec<V>(x + j);
+            for (int r = 0; r < ROWS; r++) {
+                acc[r] += load_vec<V>(a[r] + j) * xv;
+            }
+        }
+        for (int r = 0; r < ROWS; r++) {
+            T sum = 0;
+            for (int l = 0; l < W; l++) {
+                sum += acc[r][l];
+            }
+            for (int jj = j; jj < n; jj++) {
+                sum += a[r][jj] * x[jj];
+            }
+            y[i + r] += sum;
+        }
+    }
+    for (; i < m; i++) {
+        const T* a = A + static_cast<size_t>(i) * lda;
+        T sum = 0;
+        for (int j = 0; j < n; j++) {
+            sum += a[j] * x[j];
+        }
+        y[i] += sum;
+    }
+}
+
+// W matrices per step, one vector lane each. Every element of A and B is
+// one vector load at a constant offset and the loops have constant bounds,
+// so they unroll completely; N accumulators per row of C keep the FMA
+// chains independent. Lanes past count in the last slice are done scalar.
+template<int M, int K, int N, typename T, int VB>
+void batched_kernel(int count, const T* A, const T* B, T* C) {
+    typedef typename Vec<T, VB>::type V;
+    const int W = Vec<T, VB>::LANES;
+    const int S = BATCHED_GEMM_SLICE;
+    static_assert(S % W == 0, "slices hold whole vectors");
+
+    for (int first = 0; first < count; first += S) {
+        const T* a = A + static_cast<size_t>(first) * M * K;
+        const T* b = B + static_cast<size_t>(first) * K * N;
+        T* c = C + static_cast<size_t>(first) * M * N;
+        int lanes = std::min(S, count - first);
+
+        int l = 0;
+        for (; l + W <= lanes; l += W) {
+#pragma GCC unroll 16
+            for (int i = 0; i < M; i++) {
+                V acc[N];
+#pragma GCC unroll 16
+                for (int j = 0; j < N; j++) {
+                    acc[j] = V{};
+                }
+#pragma GCC unroll 16
+                for (int p = 0; p < K; p++) {
+                    V av = load_vec<V>(a + (i * K + p) * S + l);
+#pragma GCC unroll 16
+                    for (int j = 0; j < N; j++) {
+                        acc[j] += av * load_vec<V>(b + (p * N + j) * S + l);
+                    }
+                }
+#pragma GCC unroll 16
+                for (int j = 0; j < N; j++) {
+                    store_vec(c + (i * N + j) * S + l, acc[j]);
+                }
+            }
+        }
+        for (; l < lanes; l++) {
+            for (int i = 0; i < M; i++) {
+                for (int j = 0; j < N; j++) {
+                    T sum = 0;
+                    for (int p = 0; p < K; p++) {
+                        sum += a[(i * K + p) * S + l] * b[(p * N + j) * S + l];
+                    }
+                    c[(i * N + j) * S + l] = sum;
+                }
+            }
+        }
+    }
+}
+
+} // namespace
+
+#define BATCHED_GEMM_INSTANTIATE(isa, M, K, N)                                                     \
+    template void batched_gemm_##isa<M, K, N, int32_t>(int, const int32_t*, const int32_t*, int32_t*); \
+    template void batched_gemm_##isa<M, K, N, float>(int, const float*, const float*, float*);     \
+    template void batched_gemm_##isa<M, K, N, double>(int, const double*, const double*, double*);
+
+#define GEMM_KERNEL_DEFINE_ISA(isa, vector_bytes)                                                     \
+    void gemm_##isa(int m, int n, int k, const int32_t* A, int lda, const int32_t* B, int ldb,       \
+                    int32_t* C, int ldc) {                                                            \
+        gemm_blocked<int32_t, vector_bytes>(m, n, k, A, lda, B, ldb, C, ldc);                         \
+    }                                                                                                 \
+    void gemm_##isa(int m, int n, int k, const float* A, int lda, const float* B, int ldb,           \
+                    float* C, int ldc) {                                                              \
+        gemm_blocked<float, vector_bytes>(m, n, k, A, lda, B, ldb, C, ldc);                           \
+    }                                                                                                 \
+    void gemm_##isa(int m, int n, int k, const double* A, int lda, const double* B, int ldb,         \
+                    double* C, int ldc) {                                                             \
+        gemm_blocked<double, vector_bytes>(m, n, k, A, lda, B, ldb, C, ldc);                          \
+    }                                                                                                 \
+    void gemm_##isa(int m, int n, int k, const int8_t* A, int lda, const int8_t* B, int ldb,         \
+                    int32_t* C, int ldc) {                                                            \
+        gemm_pairs<int8_t, vector_bytes>(m, n, k, A, lda, B, ldb, C, ldc);                            \
+    }                                                                                                 \
+    void gemm_##isa(int m, int n, int k, const int16_t* A, int lda, const int16_t* B, int ldb,       \
+                    int32_t* C, int ldc) {                                                            \
+        gemm_pairs<int16_t, vector_bytes>(m, n, k, A, lda, B, ldb, C, ldc);                           \
+    }                                                                                                 \
+    void gemv_##isa(int m, int n, const int32_t* A, int lda, const int32_t* x, int32_t* y) {          \
+        gemv_blocked<int32_t, vector_bytes>(m, n, A, lda, x, y);                                      \
+    }                                                                                                 \
+    void gemv_##isa(int m, int n, const float* A, int lda, const float* x, float* y) {                \
+        gemv_blocked<float, vector_bytes>(m, n, A, lda, x, y);                                        \
+    }                                                                                                 \
+    void gemv_##isa(int m, int n, const double* A, int lda, const double* x, double* y) {             \
+        gemv_blocked<double, vector_bytes>(m, n, A, lda, x, y);                                       \
+    }                                                                                                 \
+    template<int M, int K, int N, typename T>                                                         \
+    void batched_gemm_##isa(int count, const T* A, const T* B, T* C) {                                \
+        batched_kernel<M, K, N, T, vector_bytes>(count, A, B, C);                                     \
+    }                                                                                                 \
+    BATCHED_GEMM_SHAPES(BATCHED_GEMM_INSTANTIATE, isa)
+
+#endif // GEMM_KERNEL_IMPL_H
@@ -0,0 +1,249 @@
+#include "gemm_kernel.h"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+// Standalone comparison of the blocked kernels against the naive loops,
+// for every element type and every instruction set this CPU supports.
+// int8 and int16 accumulate into int32 and are checked against int32 on
+// signed operands down to the most negative value.
+// The batched kernel is compared with the per-product calls it replaces.
+//   kernel_bench [sizes=256,512,1024] [count=65536] [min_time=0.2]
+
+static double min_time = 0.2;
+
+template<typename F>
+static double time_per_call(F&& call) {
+    int calls = 0;
+    auto start = std::chrono::steady_clock::now();
+    double elapsed = 0;
+    do {
+        call();
+        calls++;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (elapsed < min_time);
+    return elapsed / calls;
+}
+
+template<typename T>
+static void fill(std::vector<T>& v, unsigned seed) {
+    for (size_t i = 0; i < v.size(); i++) {
+        seed = seed * 1103515245u + 12345u;
+        v[i] = static_cast<T>(1 + (seed >> 16) % 10);
+    }
+}
+
+// Signed values for the narrow operands, reaching the most negative one
+// so the int8_t widening and the pmaddwd pairs see negative and -128
+// inputs. The range is the whole type as long as k products summed into
+// Acc cannot overflow: all of int8_t, and +-1448 of int16_t at k = 1024.
+template<typename T, typename Acc>
+static void fill_signed(std::vector<T>& v, unsigned seed, int k) {
+    long long bound = static_cast<long long>(std::sqrt(static_cast<double>(std::numeric_limits<Acc>::max()) / k));
+    long long high = std::min<long long>(std::numeric_limits<T>::max(), bound);
+    long long low = -std::numeric_limits<T>::min() <= bound ? std::numeric_limits<T>::min() : -high;
+    for (size_t i = 0; i < v.size(); i++) {
+        seed = seed * 1103515245u + 12345u;
+        v[i] = static_cast<T>(low + (seed >> 8) % (high - low + 1));
+    }
+    // Both ends for certain, the lowest one in a K pair
+    v[0] = v[1] = static_cast<T>(low);
+    v.back() = static_cast<T>(high);
+}
+
+static std::vector<KernelIsa> supported_isas() {
+    std::vector<KernelIsa> isas;
+    for (KernelIsa isa : {KernelIsa::Generic, KernelIsa::Avx2, KernelIsa::Avx512}) {
+        if (kernel_isa_supported(isa)) {
+            isas.push_back(isa);
+        }
+    }
+    return isas;
+}
+
+// With Acc wider than T the naive column is the Acc loop on the same
+// values, and the kernel must match it exactly
+template<typename T, typename Acc = T>
+static void bench_gemm(const char* type, int n) {
+    std::vector<T> A(static_cast<size_t>(n) * n), B(A.size());
+    std::vector<Acc> C(A.size()), expected(A.size());
+    if constexpr (sizeof(T) < sizeof(Acc)) {
+        fill_signed<T, Acc>(A, 1, n);
+        fill_signed<T, Acc>(B, 2, n);
+    } else {
+        fill(A, 1);
+        fill(B, 2);
+    }
+    std::vector<Acc> wide_a(A.begin(), A.end()), wide_b(B.begin(), B.end());
+
+    double flops = 2.0 * n * n * n;
+    double naive = time_per_call([&] { naive_gemm(n, n, n, wide_a.data(), n, wide_b.data(), n, expected.data(), n); });
+    std::fill(expected.begin(), expected.end(), Acc(0));
+    naive_gemm(n, n, n, wide_a.data(), n, wide_b.data(), n, expected.data(), n);
+
+    std::cout << std::setw(7) << type << std::setw(7) << n << std::setw(11) << flops / naive / 1e9;
+    double best = naive;
+    bool correct = true;
+    for (KernelIsa isa : supported_isas()) {
+        set_kernel_isa(isa);
+        double t = time_per_call([&] { local_gemm(n, n, n, A.data(), n, B.data(), n, C.data(), n); });
+        std::fill(C.begin(), C.end(), Acc(0));
+        local_gemm(n, n, n, A.data(), n, B.data(), n, C.data(), n);
+        correct = correct && C == expected;
+        best = std::min(best, t);
+        std::cout << std::setw(11) << flops / t / 1e9;
+    }
+    std::cout << std::setw(10) << naive / best << "x" << (correct ? "  ok" : "  MISMATCH") << "\n";
+}
+
+template<typename T>
+static void bench_gemv(const char* type, int n) {
+    std::vector<T> A(static_cast<size_t>(n) * n), x(n), y(n), expected(n);
+    fill(A, 3);
+    fill(x, 4);
+
+    double flops = 2.0 * n * n;
+    double naive = time_per_call([&] { naive_gemv(n, n, A.data(), n, x.data(), expected.data()); });
+    std::fill(expected.begin(), expected.end(), T(0));
+    naive_gemv(n, n, A.data(), n, x.data(), expected.data());
+
+    std::cout << std::setw(7) << type << std::setw(7) << n << std::setw(11) << flops / naive / 1e9;
+    double best = naive;
+    bool correct = true;
+    for (KernelIsa isa : supported_isas()) {
+        set_kernel_isa(isa);
+        double t = time_per_call([&] { local_gemv(n, n, A.data(), n, x.data(), y.data()); });
+        std::fill(y.begin(), y.end(), T(0));
+        local_gemv(n, n, A.data(), n, x.data(), y.data());
+        correct = correct && y == expected;
+        best = std::min(best, t);
+        std::cout << std::setw(11) << flops / t / 1e9;
+    }
+    std::cout << std::setw(10) << naive / best << "x" << (correct ? "  ok" : "  MISMATCH") << "\n";
+}
+
+// Every product once through naive_gemm and local_gemm on matrices stored
+// one after another, then the whole batch through batched_gemm in its
+// sliced structure-of-arrays layout
+template<typename T, int M, int K, int N>
+static void bench_batched(const char* type, int count) {
+    std::vector<T> A(static_cast<size_t>(M) * K * count), B(static_cast<size_t>(K) * N * count);
+    std::vector<T> C(static_cast<size_t>(M) * N * count), expected(C.size());
+    fill(A, 5);
+    fill(B, 6);
+    std::vector<T> soa_a(batched_size(M * K, count)), soa_b(batched_size(K * N, count));
+    std::vector<T> soa_c(batched_size(M * N, count));
+    for (int b = 0; b < count; b++) {
+        for (int e = 0; e < M * K; e++) {
+            soa_a[batched_index(M * K, b, e)] = A[static_cast<size_t>(b) * M * K + e];
+        }
+        for (int e = 0; e < K * N; e++) {
+            soa_b[batched_index(K * N, b, e)] = B[static_cast<size_t>(b) * K * N + e];
+        }
+    }
+
+    auto each = [&](auto kernel) {
+        for (int b = 0; b < count; b++) {
+            kernel(M, N, K, &A[static_cast<size_t>(b) * M * K], K, &B[static_cast<size_t>(b) * K * N], N,
+                   &expected[static_cast<size_t>(b) * M * N], N);
+        }
+    };
+    double flops = 2.0 * M * N * K * count;
+    double naive = time_per_call([&] { each(naive_gemm<T>); });
+    double local = time_per_call([&] { each(local_gemm<T>); });
+    std::fill(expected.begin(), expected.end(), T(0));
+    each(naive_gemm<T>);
+
+    std::string shape = std::to_string(M) + "x" + std::to_string(K) + "x" + std::to_string(N);
+    std::cout << std::setw(7) << type << std::setw(7) << shape << std::setw(11) << flops / naive / 1e9
+              << std::setw(11) << flops / local / 1e9;
+    double best = local;
+    bool correct = true;
+    for (KernelIsa isa : supported_isas()) {
+        set_kernel_isa(isa);
+        std::fill(soa_c.begin(), soa_c.end(), T(0));
+        double t = time_per_call([&] { batched_gemm<M, K, N, T>(count, soa_a.data(), soa_b.data(), soa_c.data()); });
+        for (int b = 0; b < count; b++) {
+            for (int e = 0; e < M * N; e++) {
+                correct = correct && soa_c[batched_index(M * N, b, e)] == expected[static_cast<size_t>(b) * M * N + e];
+            }
+        }
+        best = std::min(best, t);
+        std::cout << std::setw(11) << flops / t / 1e9;
+    }
+    std::cout << std::setw(10) << local / best << "x" << (correct ? "  ok" : "  MISMATCH") << "\n";
+}
+
+static void print_header(const char* title) {
+    std::cout << "\n" << title << " (GFLOP/s)\n";
+    std::cout << std::setw(7) << "type" << std::setw(7) << "n" << std::setw(11) << "naive";
+    for (KernelIsa isa : supported_isas()) {
+        std::cout << std::setw(11) << kernel_isa_name(isa);
+    }
+    std::cout << std::setw(11) << "speedup" << "\n";
+}
+
+static void print_batched_header(int count) {
+    std::cout << "\nBatched C = A * B, " << count << " products (GFLOP/s; speedup over local_gemm per product)\n";
+    std::cout << std::setw(7) << "type" << std::setw(7) << "shape" << std::setw(11) << "naive" << std::setw(11)
+              << "local_gemm";
+    for (KernelIsa isa : supported_isas()) {
+        std::cout << std::setw(11) << kernel_isa_name(isa);
+    }
+    std::cout << std::setw(11) << "speedup" << "\n";
+}
+
+int main(int argc, char** argv) {
+    std::vector<int> sizes = {256, 512, 1024};
+    int count = 65536;
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg.rfind("sizes=", 0) == 0) {
+            sizes.clear();
+            for (size_t pos = 6; pos < arg.size(); ) {
+                size_t comma = arg.find(',', pos);
+                sizes.push_back(std::atoi(arg.substr(pos, comma - pos).c_str()));
+                pos = comma == std::string::npos ? arg.size() : comma + 1;
+            }
+        } else if (arg.rfind("count=", 0) == 0) {
+            count = std::atoi(arg.c_str() + 6);
+        } else if (arg.rfind("min_time=", 0) == 0) {
+            min_time = std::atof(arg.c_str() + 9);
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [sizes=256,512,1024] [count=N] [min_time=SECONDS]\n";
+            return 1;
+        }
+    }
+
+    std::cout << "Default kernel: " << kernel_isa_name(kernel_isa()) << "\n";
+    std::cout << std::fixed << std::setprecision(2);
+
+    print_header("GEMM C += A * B, n x n");
+    for (int n : sizes) {
+        bench_gemm<int32_t>("int32", n);
+        bench_gemm<int16_t, int32_t>("int16", n);
+        bench_gemm<int8_t, int32_t>("int8", n);
+        bench_gemm<float>("float", n);
+        bench_gemm<double>("double", n);
+    }
+
+    print_header("GEMV y += A * x, n x n");
+    for (int n : sizes) {
+        bench_gemv<int32_t>("int32", n * 4);
+        bench_gemv<float>("float", n * 4);
+        bench_gemv<double>("double", n * 4);
+    }
+
+    print_batched_header(count);
+    bench_batched<int32_t, 4, 5, 6>("int32", count);
+    bench_batched<float, 4, 5, 6>("float", count);
+    bench_batched<double, 4, 5, 6>("double", count);
+    bench_batched<float, 8, 8, 8>("float", count);
+    bench_batched<double, 8, 8, 8>("double", count);
+    return 0;
+}
@@ -0,0 +1,185 @@
+#include "matrix_io.h"
+#include <cstring>
+#include <iostream>
+
+static const char MAGIC[4] = {'M', 'A', 'T', 'B'};
+static const uint32_t VERSION = 1;
+
+const char* matrix_type_name(uint32_t dtype) {
+    switch (dtype) {
+    case MATRIX_INT32:
+        return "int32";
+    case MATRIX_FLOAT:
+        return "float";
+    case MATRIX_DOUBLE:
+        return "double";
+    default:
+        return nullptr;
+    }
+}
+
+static bool type_code(MPI_Datatype type, uint32_t& dtype) {
+    if (type == MPI_INT32_T || type == MPI_INT) {
+        dtype = MATRIX_INT32;
+    } else if (type == MPI_FLOAT) {
+        dtype = MATRIX_FLOAT;
+    } else if (type == MPI_DOUBLE) {
+        dtype = MATRIX_DOUBLE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static int rank_in(MPI_Comm comm) {
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    return rank;
+}
+
+static void report(MPI_Comm comm, const std::string& path, const std::string& what, int error = MPI_SUCCESS) {
+    if (rank_in(comm) != 0) {
+        return;
+    }
+    std::cerr << path << ": " << what;
+    if (error != MPI_SUCCESS) {
+        char text[MPI_MAX_ERROR_STRING];
+        int length;
+        MPI_Error_string(error, text, &length);
+        std::cerr << " (" << text << ")";
+    }
+    std::cerr << std::endl;
+}
+
+// Every rank agrees on failure if any rank failed
+static bool all_ok(MPI_Comm comm, bool ok) {
+    int flag = ok ? 1 : 0;
+    MPI_Allreduce(MPI_IN_PLACE, &flag, 1, MPI_INT, MPI_LAND, comm);
+    return flag != 0;
+}
+
+// View of the tile within the element data after the header. Empty tiles
+// see nothing: MPI subarrays need at least one element in each dimension.
+static int set_tile_view(MPI_File file, long long rows, long long cols, MPI_Datatype type, const MatrixTile& tile) {
+    MPI_Datatype view = type;
+    bool empty = tile.rows == 0 || tile.cols == 0;
+    if (empty) {
+        MPI_Type_contiguous(0, type, &view);
+    } else {
+        int sizes[2] = {static_cast<int>(rows), static_cast<int>(cols)};
+        int subsizes[2] = {tile.rows, tile.cols};
+        int starts[2] = {static_cast<int>(tile.row), static_cast<int>(tile.col)};
+        MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C, type, &view);
+    }
+    MPI_Type_commit(&view);
+    int error = MPI_File_set_view(file, sizeof(MatrixHeader), type, view, "native", MPI_INFO_NULL);
+    MPI_Type_free(&view);
+    return error;
+}
+
+bool read_matrix_header(MPI_Comm comm, const std::string& path, MatrixHeader& header) {
+    MPI_File file;
+    int error = MPI_File_open(comm, path.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &file);
+    if (error != MPI_SUCCESS) {
+        report(comm, path, "cannot open", error);
+        return false;
+    }
+
+    int ok = 1;
+    MPI_Offset file_size;
+    MPI_File_get_size(file, &file_size);
+    if (rank_in(comm) == 0) {
+        MPI_Status status;
+        int count = 0;
+        std::memset(&header, 0, sizeof(header));
+        if (MPI_File_read_at(file, 0, &header, sizeof(header), MPI_BYTE, &status) != MPI_SUCCESS ||
+            MPI_Get_count(&status, MPI_BYTE, &count) != MPI_SUCCESS || count != static_cast<int>(sizeof(header))) {
+            report(comm, path, "no matrix header");
+            ok = 0;
+        } else if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+                   matrix_type_name(header.dtype) == nullptr) {
+            report(comm, path, "not a version 1 matrix file");
+            ok = 0;
+        } else if (header.rows > INT32_MAX || header.cols > INT32_MAX ||
+                   static_cast<MPI_Offset>(sizeof(header) + header.rows * header.cols * header.elem_size) >
+                       file_size) {
+            report(comm, path, "header does not match the file size");
+            ok = 0;
+        }
+    }
+    MPI_Bcast(&ok, 1, MPI_INT, 0, comm);
+    MPI_Bcast(&header, sizeof(header), MPI_BYTE, 0, comm);
+    MPI_File_close(&file);
+    return ok != 0;
+}
+
+bool read_matrix_tile(MPI_Comm comm, const std::string& path, const MatrixHeader& header,
+                      MPI_Datatype type, const MatrixTile& tile, void* data) {
+    uint32_t dtype;
+    int elem_size;
+    MPI_Type_size(type, &elem_size);
+    if (!type_code(type, dtype) || dtype != header.dtype || static_cast<uint32_t>(elem_size) != header.elem_size) {
+        report(comm, path, std::string("holds ") + matrix_type_name(header.dtype) + " elements");
+        return false;
+    }
+
+    MPI_File file;
+    int error = MPI_File_open(comm, path.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &file);
+    if (error != MPI_SUCCESS) {
+        report(comm, path, "cannot open", error);
+        return false;
+    }
+    // Both calls are collective, so every rank makes them whatever happened
+    error = set_tile_view(file, header.rows, header.cols, type, tile);
+    int read_error = MPI_File_read_all(file, data, tile.rows * tile.cols, type, MPI_STATUS_IGNORE);
+    error = error != MPI_SUCCESS ? error : read_error;
+    MPI_File_close(&file);
+    if (!all_ok(comm, error == MPI_SUCCESS)) {
+        report(comm, path, "read failed", error);
+        return false;
+    }
+    return true;
+}
+
+bool write_matrix_tile(MPI_Comm comm, const std::string& path, long long rows, long long cols,
+                       MPI_Datatype type, const MatrixTile& tile, const void* data) {
+    MatrixHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    int elem_size;
+    MPI_Type_size(type, &elem_size);
+    header.elem_size = elem_size;
+    header.rows = rows;
+    header.cols = cols;
+    if (!type_code(type, header.dtype)) {
+        report(comm, path, "unsupported element type");
+        return false;
+    }
+
+    // Drop an older, longer file first so no stale bytes remain past the end
+    if (rank_in(comm) == 0) {
+        MPI_File_delete(path.c_str(), MPI_INFO_NULL);
+    }
+    MPI_Barrier(comm);
+
+    MPI_File file;
+    int error = MPI_File_open(comm, path.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file);
+    if (error != MPI_SUCCESS) {
+        report(comm, path, "cannot create", error);
+        return false;
+    }
+    if (rank_in(comm) == 0) {
+        error = MPI_File_write_at(file, 0, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE);
+    }
+    // Both calls are collective, so every rank makes them whatever happened
+    int view_error = set_tile_view(file, rows, cols, type, tile);
+    int write_error = MPI_File_write_all(file, data, tile.rows * tile.cols, type, MPI_STATUS_IGNORE);
+    error = error != MPI_SUCCESS ? error : view_error != MPI_SUCCESS ? view_error : write_error;
+    MPI_File_close(&file);
+    if (!all_ok(comm, error == MPI_SUCCESS)) {
+        report(comm, path, "write failed", error);
+        return false;
+    }
+    return true;
+}
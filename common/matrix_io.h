@@ -0,0 +1,57 @@
+#ifndef MATRIX_IO_H
+#define MATRIX_IO_H
+
+#include <mpi.h>
+#include <cstdint>
+#include <string>
+
+// Binary matrix files: a 64-byte header followed by the elements in
+// row-major order, native byte order. Files are read and written
+// collectively with MPI-IO: every rank sets a subarray file view over its
+// own tile and calls MPI_File_read_all / MPI_File_write_all, so no tile
+// goes through another rank.
+struct MatrixHeader {
+    char magic[4];       // "MATB"
+    uint32_t version;    // 1
+    uint32_t dtype;      // MatrixType
+    uint32_t elem_size;  // Bytes per element
+    uint64_t rows;
+    uint64_t cols;
+    char reserved[32];
+};
+static_assert(sizeof(MatrixHeader) == 64, "the element data starts at byte 64");
+
+enum MatrixType : uint32_t {
+    MATRIX_INT32 = 0,
+    MATRIX_FLOAT = 1,
+    MATRIX_DOUBLE = 2
+};
+
+// "int32", "float" or "double"; nullptr for other codes
+const char* matrix_type_name(uint32_t dtype);
+
+// A rectangle of a matrix: rows [row, row + rows), cols [col, col + cols)
+struct MatrixTile {
+    long long row;
+    long long col;
+    int rows;
+    int cols;
+};
+
+// All of these are collective over comm and return the same result on every
+// rank; on failure rank 0 prints the reason to stderr.
+
+// Rank 0 reads and checks the header and broadcasts it
+bool read_matrix_header(MPI_Comm comm, const std::string& path, MatrixHeader& header);
+
+// Reads the tile into data (rows x cols, row-major). type must match the
+// header's element type; header is the one read_matrix_header returned.
+bool read_matrix_tile(MPI_Comm comm, const std::string& path, const MatrixHeader& header,
+                      MPI_Datatype type, const MatrixTile& tile, void* data);
+
+// Creates or truncates path as a rows x cols matrix of type and writes every
+// rank's tile into it. The tiles should cover the matrix without overlap.
+bool write_matrix_tile(MPI_Comm comm, const std::string& path, long long rows, long long cols,
+                       MPI_Datatype type, const MatrixTile& tile, const void* data);
+
+#endif // MATRIX_IO_H
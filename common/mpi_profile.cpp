@@ -0,0 +1,214 @@
+#include "mpi_profile.h"
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char* const call_names[PROFILE_CALLS] = {
+    "Send", "Ssend", "Isend", "Recv", "Irecv", "Sendrecv", "Sendrecv_replace", "Wait", "Barrier",
+    "Bcast", "Ibcast", "Scatter", "Scatterv", "Gather", "Gatherv", "Allgather", "Alltoall", "Alltoallv",
+    "Reduce", "Allreduce",
+};
+
+// Calls that average less than this many bytes are paying for latency
+const long long small_message = 1024;
+
+long long call_counts[PROFILE_CALLS];
+long long call_bytes[PROFILE_CALLS];
+double call_seconds[PROFILE_CALLS];
+
+std::vector<long long> bytes_to;    // Indexed by MPI_COMM_WORLD rank
+std::vector<long long> messages_to;
+double started = 0;
+int current = -1;                   // Call whose ProfileScope is alive
+
+std::map<MPI_Comm, std::vector<int>> world_ranks;
+
+int world_rank(MPI_Comm comm, int rank) {
+    if (comm == MPI_COMM_WORLD) {
+        return rank;
+    }
+    auto found = world_ranks.find(comm);
+    if (found == world_ranks.end()) {
+        MPI_Group group, world_group;
+        int size;
+        PMPI_Comm_group(comm, &group);
+        PMPI_Comm_group(MPI_COMM_WORLD, &world_group);
+        PMPI_Group_size(group, &size);
+        std::vector<int> ranks(size), translated(size);
+        for (int r = 0; r < size; r++) {
+            ranks[r] = r;
+        }
+        PMPI_Group_translate_ranks(group, size, ranks.data(), world_group, translated.data());
+        PMPI_Group_free(&group);
+        PMPI_Group_free(&world_group);
+        found = world_ranks.emplace(comm, translated).first;
+    }
+    return found->second[rank];
+}
+
+} // namespace
+
+ProfileScope::ProfileScope(ProfileCall call) : call(call), started(PMPI_Wtime()) {
+    current = call;
+}
+
+ProfileScope::~ProfileScope() {
+    call_seconds[call] += PMPI_Wtime() - started;
+    call_counts[call]++;
+    current = -1;
+}
+
+void profile_start() {
+    int size;
+    PMPI_Comm_size(MPI_COMM_WORLD, &size);
+    bytes_to.assign(size, 0);
+    messages_to.assign(size, 0);
+    started = PMPI_Wtime();
+}
+
+void profile_sent(MPI_Comm comm, int peer, long long bytes) {
+    if (current >= 0) {
+        call_bytes[current] += bytes;
+    }
+    if (peer != MPI_PROC_NULL && comm != MPI_COMM_NULL) {
+        int to = world_rank(comm, peer);
+        bytes_to[to] += bytes;
+        messages_to[to]++;
+    }
+}
+
+void profile_received(long long bytes) {
+    if (current >= 0) {
+        call_bytes[current] += bytes;
+    }
+}
+
+void profile_forget(MPI_Comm comm) {
+    world_ranks.erase(comm);
+}
+
+void profile_report() {
+    double wall = PMPI_Wtime() - started;
+    int rank, size;
+    PMPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    PMPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    // One row per rank: counts, bytes, then the bytes and messages it sent to each rank
+    const int longs = 2 * PROFILE_CALLS + 2 * size;
+    std::vector<long long> mine(longs);
+    for (int c = 0; c < PROFILE_CALLS; c++) {
+        mine[c] = call_counts[c];
+        mine[PROFILE_CALLS + c] = call_bytes[c];
+    }
+    for (int r = 0; r < size; r++) {
+        mine[2 * PROFILE_CALLS + r] = bytes_to[r];
+        mine[2 * PROFILE_CALLS + size + r] = messages_to[r];
+    }
+    std::vector<double> my_times(call_seconds, call_seconds + PROFILE_CALLS);
+    my_times.push_back(wall);
+
+    std::vector<long long> longs_all(rank == 0 ? static_cast<size_t>(longs) * size : 0);
+    std::vector<double> times_all(rank == 0 ? static_cast<size_t>(PROFILE_CALLS + 1) * size : 0);
+    PMPI_Gather(mine.data(), longs, MPI_LONG_LONG, longs_all.data(), longs, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+    PMPI_Gather(my_times.data(), PROFILE_CALLS + 1, MPI_DOUBLE, times_all.data(), PROFILE_CALLS + 1, MPI_DOUBLE,
+                0, MPI_COMM_WORLD);
+    if (rank != 0) {
+        return;
+    }
+
+    auto counts = [&](int r, int c) { return longs_all[static_cast<size_t>(r) * longs + c]; };
+    auto bytes = [&](int r, int c) { return longs_all[static_cast<size_t>(r) * longs + PROFILE_CALLS + c]; };
+    auto sent = [&](int r, int to) { return longs_all[static_cast<size_t>(r) * longs + 2 * PROFILE_CALLS + to]; };
+    auto messages = [&](int r, int to) {
+        return longs_all[static_cast<size_t>(r) * longs + 2 * PROFILE_CALLS + size + to];
+    };
+    auto seconds = [&](int r, int c) { return times_all[static_cast<size_t>(r) * (PROFILE_CALLS + 1) + c]; };
+
+    const char* env = std::getenv("MPI_PROFILE");
+    std::string prefix = env != nullptr && *env != '\0' ? env : "mpi_profile";
+    std::string report_path = prefix + ".txt", matrix_path = prefix + "_matrix.csv";
+    FILE* report = std::fopen(report_path.c_str(), "w");
+    FILE* matrix = std::fopen(matrix_path.c_str(), "w");
+
+    // Short per-rank summary and the call totals go to stderr
+    std::fprintf(stderr, "MPI profile: %d ranks\n%6s %12s %12s %7s %10s %14s\n", size, "rank", "wall_s", "mpi_s",
+                 "mpi_%", "calls", "bytes_sent");
+    for (int r = 0; r < size; r++) {
+        double mpi = 0;
+        long long calls = 0, out = 0;
+        for (int c = 0; c < PROFILE_CALLS; c++) {
+            mpi += seconds(r, c);
+            calls += counts(r, c);
+        }
+        for (int to = 0; to < size; to++) {
+            out += sent(r, to);
+        }
+        double wall_r = seconds(r, PROFILE_CALLS);
+        std::fprintf(stderr, "%6d %12.6f %12.6f %7.1f %10lld %14lld\n", r, wall_r, mpi,
+                     wall_r > 0 ? 100 * mpi / wall_r : 0.0, calls, out);
+    }
+    std::fprintf(stderr, "%-18s %10s %14s %12s %12s %12s\n", "call", "calls", "bytes", "bytes/call", "sum_s",
+                 "max_rank_s");
+    for (int c = 0; c < PROFILE_CALLS; c++) {
+        long long calls = 0, total = 0;
+        double sum = 0, slowest = 0;
+        for (int r = 0; r < size; r++) {
+            calls += counts(r, c);
+            total += bytes(r, c);
+            sum += seconds(r, c);
+            slowest = seconds(r, c) > slowest ? seconds(r, c) : slowest;
+        }
+        if (calls == 0) {
+            continue;
+        }
+        long long per_call = total / calls;
+        std::fprintf(stderr, "%-18s %10lld %14lld %12lld %12.6f %12.6f%s\n", call_names[c], calls, total, per_call,
+                     sum, slowest, total > 0 && per_call < small_message ? "  small" : "");
+    }
+
+    // Full per-rank tables and the message-count matrix go to the report file
+    if (report != nullptr) {
+        for (int r = 0; r < size; r++) {
+            std::fprintf(report, "rank %d wall_s %.6f\n", r, seconds(r, PROFILE_CALLS));
+            for (int c = 0; c < PROFILE_CALLS; c++) {
+                if (counts(r, c) > 0) {
+                    std::fprintf(report, "  %-18s calls %10lld bytes %14lld seconds %.6f\n", call_names[c],
+                                 counts(r, c), bytes(r, c), seconds(r, c));
+                }
+            }
+        }
+        std::fprintf(report, "messages from\\to");
+        for (int to = 0; to < size; to++) {
+            std::fprintf(report, " %d", to);
+        }
+        std::fprintf(report, "\n");
+        for (int r = 0; r < size; r++) {
+            std::fprintf(report, "%d", r);
+            for (int to = 0; to < size; to++) {
+                std::fprintf(report, " %lld", messages(r, to));
+            }
+            std::fprintf(report, "\n");
+        }
+        std::fclose(report);
+    }
+    if (matrix != nullptr) {
+        std::fprintf(matrix, "from\\to");
+        for (int to = 0; to < size; to++) {
+            std::fprintf(matrix, ",%d", to);
+        }
+        std::fprintf(matrix, "\n");
+        for (int r = 0; r < size; r++) {
+            std::fprintf(matrix, "%d", r);
+            for (int to = 0; to < size; to++) {
+                std::fprintf(matrix, ",%lld", sent(r, to));
+            }
+            std::fprintf(matrix, "\n");
+        }
+        std::fclose(matrix);
+    }
+    std::fprintf(stderr, "MPI profile written to %s and %s\n", report_path.c_str(), matrix_path.c_str());
+}
@@ -0,0 +1,61 @@
+#ifndef MPI_PROFILE_H
+#define MPI_PROFILE_H
+
+#include <mpi.h>
+
+// Per-call profile behind the traffic wrappers in comm_volume.cpp, built in
+// with make PROFILE=1. Every wrapped call adds its count, wall time and
+// bytes to a fixed table, and bytes sent are also booked against the
+// MPI_COMM_WORLD rank of the receiver. At MPI_Finalize rank 0 prints a
+// per-rank summary to stderr and writes the full tables to $MPI_PROFILE.txt
+// and the merged sender x receiver matrix to $MPI_PROFILE_matrix.csv
+// (MPI_PROFILE defaults to "mpi_profile").
+//
+// Bytes are the payload sent for send calls and collectives, and received
+// for MPI_Recv (from the status) and MPI_Irecv (the posted buffer).
+// Allreduce traffic has no single receiver and stays out of the matrix.
+enum ProfileCall {
+    PROFILE_SEND,
+    PROFILE_SSEND,
+    PROFILE_ISEND,
+    PROFILE_RECV,
+    PROFILE_IRECV,
+    PROFILE_SENDRECV,
+    PROFILE_SENDRECV_REPLACE,
+    PROFILE_WAIT,
+    PROFILE_BARRIER,
+    PROFILE_BCAST,
+    PROFILE_IBCAST,
+    PROFILE_SCATTER,
+    PROFILE_SCATTERV,
+    PROFILE_GATHER,
+    PROFILE_GATHERV,
+    PROFILE_ALLGATHER,
+    PROFILE_ALLTOALL,
+    PROFILE_ALLTOALLV,
+    PROFILE_REDUCE,
+    PROFILE_ALLREDUCE,
+    PROFILE_CALLS
+};
+
+// Times one wrapped call; bytes booked while it is alive belong to it
+class ProfileScope {
+public:
+    explicit ProfileScope(ProfileCall call);
+    ~ProfileScope();
+
+private:
+    ProfileCall call;
+    double started;
+};
+
+void profile_start();
+// peer is a rank of comm, or MPI_PROC_NULL for traffic with no single receiver
+void profile_sent(MPI_Comm comm, int peer, long long bytes);
+void profile_received(long long bytes);
+// Drops the cached rank translation before comm's handle can be reused
+void profile_forget(MPI_Comm comm);
+// Collective over MPI_COMM_WORLD; call before PMPI_Finalize
+void profile_report();
+
+#endif // MPI_PROFILE_H
@@ -0,0 +1,96 @@
+#include "thread_pool.h"
+#include <pthread.h>
+#include <sched.h>
+
+static void pin_thread(pthread_t thread, int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(thread, sizeof(set), &set);
+}
+
+ThreadPool::ThreadPool(int threads, bool pin, int first_cpu) : pin(pin) {
+    if (pin) {
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        sched_getaffinity(0, sizeof(allowed), &allowed);
+        std::vector<int> mask;
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &allowed)) {
+                mask.push_back(cpu);
+            }
+        }
+        for (int i = 0; i < threads; i++) {
+            cpus.push_back(mask[(first_cpu + i) % mask.size()]);
+        }
+        pin_thread(pthread_self(), cpus[0]);
+    }
+    for (int worker = 1; worker < threads; worker++) {
+        workers.emplace_back(&ThreadPool::worker_loop, this, worker);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::parallel_for(int count, const std::function<void(int, int)>& body) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        task = &body;
+        task_count = count;
+        next_item = 0;
+        busy = static_cast<int>(workers.size());
+        generation++;
+    }
+    wake.notify_all();
+    run_items(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this] { return busy == 0; });
+    task = nullptr;
+}
+
+void ThreadPool::worker_loop(int worker) {
+    if (pin) {
+        pin_thread(pthread_self(), cpus[worker]);
+    }
+    long seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+        }
+        run_items(worker);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--busy == 0) {
+            finished.notify_one();
+        }
+    }
+}
+
+void ThreadPool::run_items(int worker) {
+    while (true) {
+        int item;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (next_item >= task_count) {
+                return;
+            }
+            item = next_item++;
+        }
+        (*task)(item, worker);
+    }
+}
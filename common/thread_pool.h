@@ -0,0 +1,49 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for the compute phase inside one MPI rank.
+// The thread that calls parallel_for works as worker 0, so only it ever
+// talks to MPI and MPI_THREAD_FUNNELED is enough.
+class ThreadPool {
+public:
+    // With pin, worker i is bound to the i-th CPU of the process affinity
+    // mask counted from first_cpu, wrapping around the mask.
+    ThreadPool(int threads, bool pin = false, int first_cpu = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const { return static_cast<int>(workers.size()) + 1; }
+    bool pinned() const { return pin; }
+
+    // Runs body(item, worker) for every item in [0, count) and returns when
+    // all of them are done. Items are handed out one at a time.
+    void parallel_for(int count, const std::function<void(int, int)>& body);
+
+private:
+    std::vector<std::thread> workers;
+    std::vector<int> cpus;
+    bool pin;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    const std::function<void(int, int)>* task = nullptr;
+    int task_count = 0;
+    int next_item = 0;
+    int busy = 0;
+    long generation = 0;
+    bool stopping = false;
+
+    void worker_loop(int worker);
+    void run_items(int worker);
+};
+
+#endif // THREAD_POOL_H
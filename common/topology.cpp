@@ -0,0 +1,81 @@
+#include "topology.h"
+#include <map>
+
+static NodeTopology build_topology() {
+    NodeTopology topology;
+    int world_rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, world_rank, MPI_INFO_NULL, &topology.node);
+    MPI_Comm_rank(topology.node, &topology.node_rank);
+    MPI_Comm_size(topology.node, &topology.node_size);
+
+    // Leaders are ordered by world rank, which orders the nodes. Each leader
+    // finds where its node starts in the node-major order and tells the node.
+    bool leader = topology.node_rank == 0;
+    MPI_Comm_split(MPI_COMM_WORLD, leader ? 0 : MPI_UNDEFINED, world_rank, &topology.leaders);
+    int layout[3] = {0, 0, 0}; // node index, node count, first position
+    if (leader) {
+        MPI_Comm_rank(topology.leaders, &layout[0]);
+        MPI_Comm_size(topology.leaders, &layout[1]);
+        MPI_Exscan(&topology.node_size, &layout[2], 1, MPI_INT, MPI_SUM, topology.leaders);
+        if (layout[0] == 0) {
+            layout[2] = 0; // MPI_Exscan leaves rank 0's result undefined
+        }
+    }
+    MPI_Bcast(layout, 3, MPI_INT, 0, topology.node);
+    topology.node_index = layout[0];
+    topology.nodes = layout[1];
+    topology.local_rank = layout[2] + topology.node_rank;
+
+    MPI_Comm_split(MPI_COMM_WORLD, 0, topology.local_rank, &topology.local);
+    return topology;
+}
+
+const NodeTopology& node_topology() {
+    static const NodeTopology topology = build_topology();
+    return topology;
+}
+
+const RankGroups& rank_groups(int group_size) {
+    static std::map<int, RankGroups> cache;
+    auto found = cache.find(group_size);
+    if (found != cache.end()) {
+        return found->second;
+    }
+
+    const NodeTopology& topology = node_topology();
+    RankGroups groups;
+    groups.group = topology.local_rank / group_size;
+    groups.member = topology.local_rank % group_size;
+    MPI_Comm_split(topology.local, groups.group, groups.member, &groups.members);
+    MPI_Comm_split(topology.local, groups.member == 0 ? 0 : MPI_UNDEFINED, groups.group, &groups.leaders);
+    return cache.emplace(group_size, groups).first->second;
+}
+
+void cart_create_local(int ndims, const int dims[], const int periods[], MPI_Comm* grid) {
+    MPI_Cart_create(node_topology().local, ndims, dims, periods, 0, grid);
+}
+
+NodeBuffer::NodeBuffer(size_t bytes) : bytes(bytes) {
+    const NodeTopology& topology = node_topology();
+    MPI_Aint mine = topology.node_rank == 0 ? static_cast<MPI_Aint>(bytes) : 0;
+    MPI_Win_allocate_shared(mine, 1, MPI_INFO_NULL, topology.node, &base, &win);
+    if (topology.node_rank != 0) {
+        MPI_Aint leader_bytes;
+        int unit;
+        MPI_Win_shared_query(win, 0, &leader_bytes, &unit, &base);
+    }
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, win);
+}
+
+NodeBuffer::~NodeBuffer() {
+    MPI_Win_unlock_all(win);
+    MPI_Win_free(&win);
+}
+
+void NodeBuffer::sync() {
+    MPI_Win_sync(win);
+    MPI_Barrier(node_topology().node);
+    MPI_Win_sync(win);
+}
@@ -0,0 +1,64 @@
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <mpi.h>
+#include <cstddef>
+
+// Node layout of MPI_COMM_WORLD, found on first use with
+// MPI_Comm_split_type(MPI_COMM_TYPE_SHARED) and cached until MPI_Finalize.
+// Nodes are numbered by their lowest world rank, so world rank 0 is always
+// node 0, node rank 0, and position 0 of the node-major order.
+struct NodeTopology {
+    MPI_Comm node;      // Ranks sharing this node's memory, by world rank
+    MPI_Comm leaders;   // Node rank 0 of every node; MPI_COMM_NULL on the others
+    MPI_Comm local;     // MPI_COMM_WORLD renumbered node by node
+    int node_rank;
+    int node_size;
+    int node_index;
+    int nodes;
+    int local_rank;     // Position in the node-major order
+};
+
+const NodeTopology& node_topology();
+
+// Consecutive blocks of group_size positions of the node-major order, so a
+// group stays on one node whenever its node holds a multiple of group_size
+// ranks. Built once per group size.
+struct RankGroups {
+    MPI_Comm members;   // This rank's group, ranked by position
+    MPI_Comm leaders;   // Member 0 of every group; MPI_COMM_NULL on the others
+    int group;
+    int member;
+};
+
+const RankGroups& rank_groups(int group_size);
+
+// MPI_Cart_create over the node-major order without reordering, so ranks
+// that are neighbours in row-major grid order share a node where they can.
+// The caller frees the grid; its rank 0 is world rank 0.
+void cart_create_local(int ndims, const int dims[], const int periods[], MPI_Comm* grid);
+
+// Memory allocated once per node with MPI_Win_allocate_shared: the node
+// leader owns it and every rank of the node reads and writes it in place.
+// Construction and destruction are collective over the node. Between
+// sync() calls ranks should only touch parts no other rank writes.
+class NodeBuffer {
+public:
+    explicit NodeBuffer(size_t bytes);
+    ~NodeBuffer();
+
+    NodeBuffer(const NodeBuffer&) = delete;
+    NodeBuffer& operator=(const NodeBuffer&) = delete;
+
+    template<typename T> T* as() const { return static_cast<T*>(base); }
+    size_t size() const { return bytes; }
+    // Makes every rank's writes so far visible to the whole node
+    void sync();
+
+private:
+    MPI_Win win;
+    void* base;
+    size_t bytes;
+};
+
+#endif // TOPOLOGY_H
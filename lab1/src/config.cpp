@@ -3,6 +3,17 @@
 #include <sstream>
 #include <stdexcept>
 
+static AdmissionPolicy parseAdmissionPolicy(const std::string& name) {
+    for (AdmissionPolicy policy : {AdmissionPolicy::DROP_TAIL, AdmissionPolicy::FUEL_QUOTA,
+                                   AdmissionPolicy::PREDICTED_WAIT, AdmissionPolicy::EARLY_DROP,
+                                   AdmissionPolicy::BALKING}) {
+        if (name == getAdmissionPolicyName(policy)) {
+            return policy;
+        }
+    }
+    throw std::runtime_error("Unknown admission policy: " + name + " (expected tail, quota, wait, red or balk)");
+}
+
 Config Config::loadConfig(const std::string& filename) {
     Config config;
     std::ifstream file(filename);
@@ -18,6 +29,13 @@ Config Config::loadConfig(const std::string& filename) {
         std::istringstream iss(line);
         std::string key;
         std::getline(iss, key, '=');
+
+        if (key == "ADMISSION_POLICY") {
+            std::string name;
+            iss >> name;
+            config.admission.policy = parseAdmissionPolicy(name);
+            continue;
+        }
         
         int value;
         iss >> value;
@@ -26,6 +44,15 @@ Config Config::loadConfig(const std::string& filename) {
         else if (key == "REQUEST_GEN_MEAN") config.requestGenMean = value;
         else if (key == "REQUEST_GEN_STD") config.requestGenStd = value;
         else if (key == "TOTAL_REQUESTS") config.totalRequests = value;
+        else if (key == "AGING_MS") config.agingMs = value;
+        else if (key == "CLASS_EMERGENCY_WEIGHT") config.classMix[static_cast<int>(Priority::EMERGENCY)] = value;
+        else if (key == "CLASS_FLEET_WEIGHT") config.classMix[static_cast<int>(Priority::FLEET)] = value;
+        else if (key == "CLASS_REGULAR_WEIGHT") config.classMix[static_cast<int>(Priority::REGULAR)] = value;
+        else if (key == "PATIENCE_MS") config.patienceMs = value;
+        else if (key == "MAX_PREDICTED_WAIT_MS") config.admission.maxPredictedWaitMs = value;
+        else if (key == "RED_MIN_PERCENT") config.admission.redMinPercent = value;
+        else if (key == "RED_MAX_PERCENT") config.admission.redMaxPercent = value;
+        else if (key == "RED_MAX_DROP_PERCENT") config.admission.redMaxDropPercent = value;
         else if (key.find("PUMP") != std::string::npos && key.find("MEAN") != std::string::npos) {
             config.pumpMeans.push_back(value);
         }
@@ -44,6 +71,36 @@ Config Config::loadConfig(const std::string& filename) {
         }
     }
 
+    int weights = 0;
+    for (int weight : config.classMix) {
+        if (weight < 0) {
+            throw std::runtime_error("Class weights must not be negative");
+        }
+        weights += weight;
+    }
+    if (weights == 0 || config.agingMs < 0) {
+        throw std::runtime_error("Invalid class weights or aging time");
+    }
+
+    const AdmissionSettings& admission = config.admission;
+    if (config.patienceMs < 0 || admission.maxPredictedWaitMs < 0 ||
+        admission.redMinPercent < 0 || admission.redMinPercent >= admission.redMaxPercent ||
+        admission.redMaxPercent > 100 || admission.redMaxDropPercent < 0 || admission.redMaxDropPercent > 100) {
+        throw std::runtime_error("Invalid patience or admission settings");
+    }
+
     config.numPumps = config.pumpMeans.size();
+
+    // Pumps of a lane complete requests at the sum of their rates
+    double laneRate[FUEL_TYPE_COUNT] = {};
+    for (int i = 0; i < config.numPumps && i < static_cast<int>(config.pumpFuelTypes.size()); i++) {
+        if (config.pumpMeans[i] <= 0) {
+            throw std::runtime_error("Pump mean service time must be positive");
+        }
+        laneRate[static_cast<int>(config.pumpFuelTypes[i])] += 1.0 / config.pumpMeans[i];
+    }
+    for (int f = 0; f < FUEL_TYPE_COUNT; f++) {
+        config.admission.laneIntervalMs[f] = laneRate[f] > 0 ? 1 / laneRate[f] : 0;
+    }
     return config;
 }
\ No newline at end of file
@@ -9,6 +9,14 @@ struct Config {
     int requestGenStd;
     int numPumps;
     int totalRequests;
+    // Waiting time that raises a request by one priority class; 0 disables aging
+    int agingMs = 10000;
+    // Weights of the emergency, fleet and regular classes among the requests
+    int classMix[PRIORITY_COUNT] = {5, 15, 80};
+    // Mean patience of a customer, drawn per request from an exponential
+    // distribution; 0 means customers never balk or leave the queue
+    int patienceMs = 0;
+    AdmissionSettings admission;
     
     std::vector<int> pumpMeans;
     std::vector<int> pumpStds;
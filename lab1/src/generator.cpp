@@ -13,12 +13,9 @@ void handleSignalGenerator(int) {
 }
 
 RequestGenerator::RequestGenerator(SharedQueue& q, const Config& c)
-    : queue(q), config(c) {
-    std::ofstream logFile("logs/queue.log", std::ios::trunc);
-    logFile.close();
-    
-    std::ofstream rejectedLog("logs/rejected.log", std::ios::trunc);
-    rejectedLog.close();
+    : queue(q), config(c),
+      queueLog("logs/queue.log", std::ios::trunc),
+      rejectedLog("logs/rejected.log", std::ios::trunc) {
 }
 
 void RequestGenerator::run() {
@@ -38,37 +35,71 @@ FuelType RequestGenerator::getRandomFuelType() {
     }
 }
 
+Priority RequestGenerator::getRandomPriority() {
+    static std::random_device rd;
+    static std::mt19937 gen(rd());
+    static std::discrete_distribution<> dis(std::begin(config.classMix), std::end(config.classMix));
+
+    return static_cast<Priority>(dis(gen));
+}
+
+long long RequestGenerator::getRandomPatience() {
+    if (config.patienceMs == 0) {
+        return 0;
+    }
+
+    static std::random_device rd;
+    static std::mt19937 gen(rd());
+    static std::exponential_distribution<> dis(1.0 / config.patienceMs);
+
+    return std::max(1LL, static_cast<long long>(dis(gen)));
+}
+
 void RequestGenerator::generateRequests() {
     std::random_device rd;
     std::mt19937 gen(rd());
     std::normal_distribution<> delay_dist(config.requestGenMean, config.requestGenStd);
     
     int requestId = 0;
+    TimestampCache timestamps;
     
     while (running && requestId < config.totalRequests) {
         Request request;
         request.id = ++requestId;
         request.fuelType = getRandomFuelType();
+        request.priority = getRandomPriority();
         request.timestamp = std::time(nullptr);
+        request.enqueuedMs = monotonicMs();
+        request.patienceMs = getRandomPatience();
         
-        std::string timestamp = std::ctime(&request.timestamp);
-        timestamp = timestamp.substr(0, timestamp.length() - 1);
+        std::string_view timestamp = timestamps.format(request.timestamp);
         
-        if (queue.addRequest(request)) {
-            std::ofstream logFile("logs/queue.log", std::ios::app);
-            Logger::logGeneration(logFile, request.id, 
-                                getFuelTypeName(request.fuelType), 
+        switch (Admission admission = queue.addRequest(request)) {
+            case Admission::ACCEPTED:
+                Logger::logGeneration(queueLog, request.id, 
+                                    getFuelTypeName(request.fuelType), 
+                                    getPriorityName(request.priority),
+                                    timestamp);
+                break;
+            case Admission::FULL:
+                Logger::logRejected(rejectedLog, request.id,
+                                  getFuelTypeName(request.fuelType),
+                                  queue.getCurrentSize(),
+                                  timestamp);
+                break;
+            case Admission::BALKED:
+                Logger::logBalked(rejectedLog, request.id,
+                                getFuelTypeName(request.fuelType),
+                                queue.getCurrentSize(),
                                 timestamp);
-            logFile.close();
-        } else {
-            std::ofstream rejectedLog("logs/rejected.log", std::ios::app);
-            
-            Logger::logRejected(rejectedLog, request.id,
-                              getFuelTypeName(request.fuelType),
-                              queue.getCurrentSize(),
-                              timestamp);
-            
-            rejectedLog.close();
+                break;
+            default:
+                Logger::logDropped(rejectedLog, request.id,
+                                 getFuelTypeName(request.fuelType),
+                                 getAdmissionName(admission),
+                                 queue.getCurrentSize(),
+                                 timestamp);
+                break;
         }
         
         int delay = std::max(100, static_cast<int>(delay_dist(gen)));
@@ -1,6 +1,7 @@
 #pragma once
 #include "queue.h"
 #include "config.h"
+#include <fstream>
 
 class RequestGenerator {
 public:
@@ -10,7 +11,12 @@ public:
 private:
     SharedQueue& queue;
     const Config& config;
+    // Open for the life of the process, so logging an event allocates nothing
+    std::ofstream queueLog;
+    std::ofstream rejectedLog;
     
     void generateRequests();
     FuelType getRandomFuelType();
+    Priority getRandomPriority();
+    long long getRandomPatience();
 };
\ No newline at end of file
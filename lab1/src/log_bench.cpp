@@ -0,0 +1,131 @@
+#include "logger.h"
+#include "queue.h"
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+
+// Counts heap allocations around the Logger calls of the generator and
+// service hot loops and fails if any of them allocates. The log lines go
+// to /dev/null through an ofstream, as they would go to a log file.
+//   log_bench [events=100000]
+
+static long allocations = 0;
+
+void* operator new(size_t size) {
+    allocations++;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    std::free(p);
+}
+
+// The service log line built the way it was before the Logger formatted
+// into a stack buffer, as the reference
+static void logServiceWithStrings(std::ostream& file, int stationId, int requestId, FuelType fuelType, time_t time) {
+    std::string fuelName(getFuelTypeName(fuelType));
+    std::string timestamp = std::ctime(&time);
+    timestamp = timestamp.substr(0, timestamp.length() - 1);
+    std::string prefix = "[SERV]";
+    std::string msg = " Request " + std::to_string(requestId) +
+                     " serviced by station " + std::to_string(stationId) +
+                     " (fuel type: " + fuelName + ") at " + timestamp;
+    file << prefix << msg << std::endl;
+}
+
+struct Result {
+    double allocsPerEvent;
+    double nsPerEvent;
+};
+
+template<typename F>
+static Result measure(int events, F&& logEvent) {
+    logEvent(0); // First use sets up the time zone and stream state
+    long before = allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 1; i <= events; i++) {
+        logEvent(i);
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return {static_cast<double>(allocations - before) / events, elapsed * 1e9 / events};
+}
+
+int main(int argc, char** argv) {
+    int events = 100000;
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg.rfind("events=", 0) == 0 && std::atoi(arg.c_str() + 7) > 0) {
+            events = std::atoi(arg.c_str() + 7);
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [events=N]\n";
+            return 1;
+        }
+    }
+
+    std::ofstream log("/dev/null");
+    TimestampCache timestamps;
+    const FuelType fuels[] = {FuelType::AI_76, FuelType::AI_92, FuelType::AI_95};
+
+    struct Case {
+        const char* name;
+        Result result;
+    } cases[] = {
+        {"[GEN]", measure(events, [&](int i) {
+            Logger::logGeneration(log, i, getFuelTypeName(fuels[i % 3]), getPriorityName(Priority::REGULAR),
+                                  timestamps.format(std::time(nullptr)));
+        })},
+        {"[REJECT]", measure(events, [&](int i) {
+            Logger::logRejected(log, i, getFuelTypeName(fuels[i % 3]), 10, timestamps.format(std::time(nullptr)));
+        })},
+        {"[QUEUE]", measure(events, [&](int i) {
+            Logger::logQueueRemoval(log, i % 5 + 1, i, getFuelTypeName(fuels[i % 3]), i % 10,
+                                    timestamps.format(std::time(nullptr)));
+        })},
+        {"[SERV]", measure(events, [&](int i) {
+            Logger::logService(log, i % 5 + 1, i, getFuelTypeName(fuels[i % 3]), timestamps.format(std::time(nullptr)));
+        })},
+    };
+    Result strings = measure(events, [&](int i) {
+        logServiceWithStrings(log, i % 5 + 1, i, fuels[i % 3], std::time(nullptr));
+    });
+
+    bool clean = true;
+    std::cout << "Logger, " << events << " events per line type, written to /dev/null\n";
+    std::cout << std::left << std::setw(10) << "line" << std::right << std::setw(14) << "allocs/event"
+              << std::setw(10) << "ns/event" << "\n";
+    std::cout << std::fixed;
+    for (const Case& c : cases) {
+        std::cout << std::left << std::setw(10) << c.name << std::right << std::setprecision(2) << std::setw(14)
+                  << c.result.allocsPerEvent << std::setprecision(0) << std::setw(10) << c.result.nsPerEvent << "\n";
+        clean = clean && c.result.allocsPerEvent == 0;
+    }
+    std::cout << std::left << std::setw(10) << "strings" << std::right << std::setprecision(2) << std::setw(14)
+              << strings.allocsPerEvent << std::setprecision(0) << std::setw(10) << strings.nsPerEvent
+              << "   [SERV] built with std::string as before\n";
+    std::cout << "Allocation check: " << (clean ? "passed" : "FAILED") << "\n";
+    return clean ? 0 : 1;
+}
@@ -1,75 +1,147 @@
 #pragma once
-#include <string>
-#include <fstream>
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <ctime>
 #include <iostream>
+#include <ostream>
+#include <string_view>
 
 // ANSI color codes for terminal output
 namespace Color {
-    const std::string RESET   = "\033[0m";
-    const std::string RED     = "\033[31m";
-    const std::string GREEN   = "\033[32m";
-    const std::string BLUE    = "\033[34m";
-    const std::string YELLOW  = "\033[33m";
+    constexpr std::string_view RESET   = "\033[0m";
+    constexpr std::string_view RED     = "\033[31m";
+    constexpr std::string_view GREEN   = "\033[32m";
+    constexpr std::string_view BLUE    = "\033[34m";
+    constexpr std::string_view YELLOW  = "\033[33m";
 }
 
+// One log line assembled in a fixed buffer on the stack, so formatting an
+// event never allocates. Text past the end of the buffer is cut off.
+class LogLine {
+public:
+    LogLine& operator<<(std::string_view text) {
+        size_t count = std::min(text.size(), sizeof(buffer) - length);
+        std::memcpy(buffer + length, text.data(), count);
+        length += count;
+        return *this;
+    }
+
+    LogLine& operator<<(int value) {
+        auto result = std::to_chars(buffer + length, buffer + sizeof(buffer), value);
+        if (result.ec == std::errc()) {
+            length = result.ptr - buffer;
+        }
+        return *this;
+    }
+
+    std::string_view view() const { return std::string_view(buffer, length); }
+
+private:
+    char buffer[256];
+    size_t length = 0;
+};
+
+// ctime() text of a timestamp without the trailing newline. It is only
+// formatted again when the second changes, and the view stays valid until
+// the next call with a different time.
+class TimestampCache {
+public:
+    std::string_view format(time_t time) {
+        if (length == 0 || time != cached) {
+            length = ctime_r(&time, buffer) != nullptr ? std::strlen(buffer) - 1 : 0;
+            cached = time;
+        }
+        return std::string_view(buffer, length);
+    }
+
+private:
+    char buffer[32];
+    size_t length = 0;
+    time_t cached = 0;
+};
+
 class Logger {
 public:
-    static void logGeneration(std::ofstream& file, int requestId, const std::string& fuelType, const std::string& timestamp) {
-        std::string prefix = "[GEN]";
-        std::string msg = " Request " + std::to_string(requestId) + 
-                         " generated for fuel type " + fuelType + 
-                         " at " + timestamp;
-        
-        file << prefix << msg << std::endl;
-        
-        #ifdef DEBUG
-        std::cout << Color::GREEN << prefix << Color::RESET << msg << std::endl;
-        #endif
+    static void logGeneration(std::ostream& file, int requestId, std::string_view fuelType,
+                             std::string_view priority, std::string_view timestamp) {
+        LogLine msg;
+        msg << " Request " << requestId
+            << " generated for fuel type " << fuelType
+            << " (class: " << priority << ")"
+            << " at " << timestamp;
+        write(file, Color::GREEN, "[GEN]", msg);
     }
-    
-    static void logService(std::ofstream& file, int stationId, int requestId, 
-                          const std::string& fuelType, const std::string& timestamp) {
-        std::string prefix = "[SERV]";
-        std::string msg = " Request " + std::to_string(requestId) + 
-                         " serviced by station " + std::to_string(stationId) +
-                         " (fuel type: " + fuelType + ") at " + timestamp;
-        
-        file << prefix << msg << std::endl;
-        
-        #ifdef DEBUG
-        std::cout << Color::YELLOW << prefix << Color::RESET << msg << std::endl;
-        #endif
+
+    static void logService(std::ostream& file, int stationId, int requestId,
+                          std::string_view fuelType, std::string_view timestamp) {
+        LogLine msg;
+        msg << " Request " << requestId
+            << " serviced by station " << stationId
+            << " (fuel type: " << fuelType << ") at " << timestamp;
+        write(file, Color::YELLOW, "[SERV]", msg);
     }
-    
-    static void logQueueRemoval(std::ofstream& file, int stationId, int requestId, 
-                               const std::string& fuelType, int queueSize, const std::string& timestamp) {
-        std::string prefix = "[QUEUE]";
-        std::string msg = " Request " + std::to_string(requestId) + 
-                         " removed by station " + std::to_string(stationId) +
-                         " (fuel type: " + fuelType + ") from queue. " +
-                         "(" + std::to_string(queueSize) + ")" +
-                         " at " + timestamp;
-        
-        file << prefix << msg << std::endl;
-        
-        #ifdef DEBUG
-        std::cout << Color::BLUE << prefix << Color::RESET << msg << std::endl;
-        #endif
+
+    static void logQueueRemoval(std::ostream& file, int stationId, int requestId,
+                               std::string_view fuelType, int queueSize, std::string_view timestamp) {
+        LogLine msg;
+        msg << " Request " << requestId
+            << " removed by station " << stationId
+            << " (fuel type: " << fuelType << ") from queue. "
+            << "(" << queueSize << ")"
+            << " at " << timestamp;
+        write(file, Color::BLUE, "[QUEUE]", msg);
+    }
+
+    static void logRejected(std::ostream& file, int requestId,
+                           std::string_view fuelType, int queueSize,
+                           std::string_view timestamp) {
+        LogLine msg;
+        msg << " Request " << requestId
+            << " rejected (fuel type: " << fuelType << "). "
+            << "Queue is full (" << queueSize << ") "
+            << "at " << timestamp;
+        write(file, Color::RED, "[REJECT]", msg);
+    }
+
+    static void logDropped(std::ostream& file, int requestId, std::string_view fuelType,
+                          std::string_view reason, int queueSize, std::string_view timestamp) {
+        LogLine msg;
+        msg << " Request " << requestId
+            << " dropped (fuel type: " << fuelType << ") "
+            << "by " << reason << " (" << queueSize << ") "
+            << "at " << timestamp;
+        write(file, Color::RED, "[DROP]", msg);
+    }
+
+    static void logBalked(std::ostream& file, int requestId, std::string_view fuelType,
+                         int queueSize, std::string_view timestamp) {
+        LogLine msg;
+        msg << " Request " << requestId
+            << " balked (fuel type: " << fuelType << ") "
+            << "at the queue (" << queueSize << ") "
+            << "at " << timestamp;
+        write(file, Color::RED, "[BALK]", msg);
     }
-    
-    static void logRejected(std::ofstream& file, int requestId, 
-                           const std::string& fuelType, int queueSize, 
-                           const std::string& timestamp) {
-        std::string prefix = "[REJECT]";
-        std::string msg = " Request " + std::to_string(requestId) + 
-                         " rejected (fuel type: " + fuelType + "). " +
-                         "Queue is full (" + std::to_string(queueSize) + ") " +
-                         "at " + timestamp;
-        
-        file << prefix << msg << std::endl;
-        
+
+    static void logReneged(std::ostream& file, int requestId, std::string_view fuelType,
+                          int waitedMs, std::string_view timestamp) {
+        LogLine msg;
+        msg << " Request " << requestId
+            << " left the queue (fuel type: " << fuelType << ") "
+            << "after " << waitedMs << " ms "
+            << "at " << timestamp;
+        write(file, Color::RED, "[RENEGE]", msg);
+    }
+
+private:
+    static void write(std::ostream& file, std::string_view color, std::string_view prefix, const LogLine& msg) {
+        file << prefix << msg.view() << std::endl;
+
         #ifdef DEBUG
-        std::cout << Color::RED << prefix << Color::RESET << msg << std::endl;
+        std::cout << color << prefix << Color::RESET << msg.view() << std::endl;
+        #else
+        (void)color;
         #endif
     }
-};
\ No newline at end of file
+};
@@ -19,7 +19,7 @@ int main() {
         std::cout << "Starting gas station simulation in DEBUG mode" << std::endl;
         #endif
 
-        SharedQueue queue(config.maxQueueSize);
+        SharedQueue queue(config.maxQueueSize, config.agingMs, config.admission);
         std::vector<pid_t> servicePids;
         
         for (int i = 0; i < config.numPumps; i++) {
@@ -56,6 +56,8 @@ int main() {
         
         // Clean up remaining requests
         queue.cleanupRemainingRequests();
+        queue.reportAdmission(std::cout);
+        queue.reportLatency(std::cout);
         
         std::cout << "Simulation completed" << std::endl;
         
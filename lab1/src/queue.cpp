@@ -1,19 +1,61 @@
 #include "queue.h"
+#include <algorithm>
 #include <cstring>
 #include <stdexcept>
+#include <string>
 #include <fstream>
 #include <ctime>
+#include <iomanip>
+#include <limits>
 #include "logger.h"
 
+const int MAX_QUEUE_CAPACITY = 1000;
+
+// FIFO ring of the requests of one fuel type and one priority class
+struct Bucket {
+    int front;
+    int size;
+    Request requests[MAX_QUEUE_CAPACITY];
+};
+
+// Latencies in LATENCY_BUCKET_MS steps; the last bucket takes everything longer
+const int LATENCY_BUCKET_MS = 100;
+const int LATENCY_BUCKETS = 6000;
+
+struct LatencyHistogram {
+    int count;
+    long long maxMs;
+    int buckets[LATENCY_BUCKETS];
+};
+
+// Weight of the newest queue length in the RED average
+const double RED_WEIGHT = 0.2;
+
+// Every fuel type has its own lane with one bucket per priority class, so a
+// station only looks at the heads of its lane's buckets. size and maxSize
+// cover all lanes together, like the single queue did.
 struct QueueData {
     int size;
-    int front;
-    int rear;
     int maxSize;
-    Request requests[1000];
+    int agingMs;
+    AdmissionSettings admission;
+    int laneQuota[FUEL_TYPE_COUNT];
+    double averageSize;
+    long long startMs;
+    int outcomes[ADMISSION_COUNT];
+    int reneged;
+    int shutdown;
+    Bucket lanes[FUEL_TYPE_COUNT][PRIORITY_COUNT];
+    LatencyHistogram wait[PRIORITY_COUNT];
+    LatencyHistogram total[PRIORITY_COUNT];
 };
 
-SharedQueue::SharedQueue(int maxSize) {
+SharedQueue::SharedQueue(int maxSize, int agingMs, const AdmissionSettings& admission)
+    : random(std::random_device{}()) {
+    if (maxSize < 1 || maxSize > MAX_QUEUE_CAPACITY) {
+        throw std::runtime_error("Queue size must be between 1 and " + std::to_string(MAX_QUEUE_CAPACITY));
+    }
+
     key_t key = ftok(".", 'Q');
     shmId = shmget(key, sizeof(QueueData), IPC_CREAT | 0666);
     if (shmId == -1) {
@@ -25,10 +67,22 @@ SharedQueue::SharedQueue(int maxSize) {
         throw std::runtime_error("Failed to attach shared memory");
     }
 
-    data->size = 0;
-    data->front = 0;
-    data->rear = -1;
+    std::memset(static_cast<void*>(data), 0, sizeof(QueueData));
     data->maxSize = maxSize;
+    data->agingMs = agingMs;
+    data->admission = admission;
+    data->startMs = monotonicMs();
+
+    // Quotas follow the service rate of each lane; a lane without pumps
+    // gets none, since nothing would ever take its requests
+    double totalRate = 0;
+    for (double interval : admission.laneIntervalMs) {
+        totalRate += interval > 0 ? 1 / interval : 0;
+    }
+    for (int f = 0; f < FUEL_TYPE_COUNT; f++) {
+        double interval = admission.laneIntervalMs[f];
+        data->laneQuota[f] = interval > 0 ? std::max(1, static_cast<int>(maxSize / interval / totalRate + 0.5)) : 0;
+    }
 
     initializeSemaphore();
 }
@@ -45,7 +99,7 @@ void SharedQueue::initializeSemaphore() {
     if (semId == -1) {
         throw std::runtime_error("Failed to create semaphore");
     }
-    
+
     semctl(semId, 0, SETVAL, 1);
 }
 
@@ -59,90 +113,264 @@ void SharedQueue::unlockQueue() {
     semop(semId, &sb, 1);
 }
 
-bool SharedQueue::addRequest(const Request& request) {
+// Each request of the same or a more urgent class queued in the lane holds
+// it for one mean completion interval of the lane's pumps
+static double predictedWaitMs(const QueueData* data, const Request& request) {
+    int lane = static_cast<int>(request.fuelType);
+    double interval = data->admission.laneIntervalMs[lane];
+    if (interval == 0) {
+        return std::numeric_limits<double>::infinity();
+    }
+    int ahead = 0;
+    for (int c = 0; c <= static_cast<int>(request.priority); c++) {
+        ahead += data->lanes[lane][c].size;
+    }
+    return ahead * interval;
+}
+
+static Admission admit(QueueData* data, const Request& request, std::minstd_rand& random) {
+    const AdmissionSettings& settings = data->admission;
+    data->averageSize += RED_WEIGHT * (data->size - data->averageSize);
+
+    if (data->size >= data->maxSize) {
+        return Admission::FULL;
+    }
+    if (request.priority == Priority::EMERGENCY) {
+        return Admission::ACCEPTED;
+    }
+
+    int lane = static_cast<int>(request.fuelType);
+    switch (settings.policy) {
+        case AdmissionPolicy::FUEL_QUOTA: {
+            int queued = 0;
+            for (int c = 0; c < PRIORITY_COUNT; c++) {
+                queued += data->lanes[lane][c].size;
+            }
+            if (queued >= data->laneQuota[lane]) {
+                return Admission::QUOTA;
+            }
+            break;
+        }
+        case AdmissionPolicy::PREDICTED_WAIT:
+            if (predictedWaitMs(data, request) > settings.maxPredictedWaitMs) {
+                return Admission::PREDICTED_WAIT;
+            }
+            break;
+        case AdmissionPolicy::EARLY_DROP: {
+            double low = data->maxSize * settings.redMinPercent / 100.0;
+            double high = data->maxSize * settings.redMaxPercent / 100.0;
+            if (data->averageSize >= high) {
+                return Admission::EARLY_DROP;
+            }
+            if (data->averageSize > low) {
+                double probability = settings.redMaxDropPercent / 100.0 * (data->averageSize - low) / (high - low);
+                if (std::uniform_real_distribution<>(0, 1)(random) < probability) {
+                    return Admission::EARLY_DROP;
+                }
+            }
+            break;
+        }
+        case AdmissionPolicy::BALKING:
+            if (request.patienceMs > 0 && predictedWaitMs(data, request) > request.patienceMs) {
+                return Admission::BALKED;
+            }
+            break;
+        default:
+            break;
+    }
+    return Admission::ACCEPTED;
+}
+
+Admission SharedQueue::addRequest(const Request& request) {
     lockQueue();
-    bool success = false;
-    
-    if (data->size < data->maxSize) {
-        data->rear = (data->rear + 1) % data->maxSize;
-        data->requests[data->rear] = request;
+
+    Admission admission = admit(data, request, random);
+    if (admission == Admission::ACCEPTED) {
+        Bucket& bucket = data->lanes[static_cast<int>(request.fuelType)][static_cast<int>(request.priority)];
+        bucket.requests[(bucket.front + bucket.size) % MAX_QUEUE_CAPACITY] = request;
+        bucket.size++;
         data->size++;
-        success = true;
     }
-    
+    data->outcomes[static_cast<int>(admission)]++;
+
     unlockQueue();
-    return success;
+    return admission;
 }
 
+// Takes the head of the lane's bucket with the most urgent effective class.
+// A request rises one class for every agingMs it has waited, so regular
+// customers reach the front behind at most a bounded amount of newer
+// urgent traffic. Equal classes go to the request that has waited longest.
 bool SharedQueue::getRequest(int stationId, FuelType stationFuelType, Request& request) {
     lockQueue();
     bool found = false;
-    
-    if (data->size > 0) {
-        int matchIndex = -1;
-        
-        for (int i = 0; i < data->size; i++) {
-            int idx = (data->front + i) % data->maxSize;
-            if (data->requests[idx].fuelType == stationFuelType) {
-                matchIndex = i;
-                break;
-            }
+
+    Bucket* lane = data->lanes[static_cast<int>(stationFuelType)];
+    long long now = monotonicMs();
+    int best = -1;
+    long long bestLevel = 0;
+    for (int c = 0; c < PRIORITY_COUNT; c++) {
+        if (lane[c].size == 0) {
+            continue;
         }
-        
-        if (matchIndex != -1) {
-            int idx = (data->front + matchIndex) % data->maxSize;
-            request = data->requests[idx];
-            
-            for (int i = matchIndex; i < data->size - 1; i++) {
-                int curr = (data->front + i) % data->maxSize;
-                int next = (data->front + i + 1) % data->maxSize;
-                data->requests[curr] = data->requests[next];
-            }
-            
-            data->size--;
-            if (data->size == 0) {
-                data->front = 0;
-                data->rear = -1;
-            } else {
-                data->rear = (data->front + data->size - 1) % data->maxSize;
-            }
-            
-            found = true;
+        const Request& head = lane[c].requests[lane[c].front];
+        long long level = c;
+        if (data->agingMs > 0) {
+            level = std::max(0LL, c - (now - head.enqueuedMs) / data->agingMs);
+        }
+        if (best == -1 || level < bestLevel ||
+            (level == bestLevel && head.enqueuedMs < lane[best].requests[lane[best].front].enqueuedMs)) {
+            best = c;
+            bestLevel = level;
         }
     }
-    
+
+    if (best != -1) {
+        Bucket& bucket = lane[best];
+        request = bucket.requests[bucket.front];
+        bucket.front = (bucket.front + 1) % MAX_QUEUE_CAPACITY;
+        bucket.size--;
+        data->size--;
+        found = true;
+    }
+
     unlockQueue();
     return found;
 }
 
 void SharedQueue::cleanupRemainingRequests() {
     lockQueue();
-    
+
     if (data->size > 0) {
         std::ofstream rejectedLog("logs/rejected.log", std::ios::app);
-        
-        for (int i = 0; i < data->size; i++) {
-            int idx = (data->front + i) % data->maxSize;
-            Request& request = data->requests[idx];
-            
-            Logger::logRejected(rejectedLog, request.id,
-                              getFuelTypeName(request.fuelType),
-                              data->size,
-                              " (shutdown)");
-            
+
+        for (int f = 0; f < FUEL_TYPE_COUNT; f++) {
+            for (int c = 0; c < PRIORITY_COUNT; c++) {
+                Bucket& bucket = data->lanes[f][c];
+                for (int i = 0; i < bucket.size; i++) {
+                    Request& request = bucket.requests[(bucket.front + i) % MAX_QUEUE_CAPACITY];
+
+                    Logger::logRejected(rejectedLog, request.id,
+                                      getFuelTypeName(request.fuelType),
+                                      data->size,
+                                      " (shutdown)");
+                }
+                bucket.front = 0;
+                bucket.size = 0;
+            }
         }
 
         rejectedLog.close();
-        
+
         // Clear the queue
+        data->shutdown += data->size;
         data->size = 0;
-        data->front = 0;
-        data->rear = -1;
     }
-    
+
     unlockQueue();
 }
 
 int SharedQueue::getCurrentSize() const {
     return data->size;
 }
+
+// Buckets are compacted in place, keeping the order of the requests that stay
+int SharedQueue::removeExpired(Request* expired, int capacity) {
+    lockQueue();
+
+    long long now = monotonicMs();
+    int count = 0;
+    for (int f = 0; f < FUEL_TYPE_COUNT; f++) {
+        for (int c = 0; c < PRIORITY_COUNT; c++) {
+            Bucket& bucket = data->lanes[f][c];
+            int kept = 0;
+            for (int i = 0; i < bucket.size; i++) {
+                const Request& request = bucket.requests[(bucket.front + i) % MAX_QUEUE_CAPACITY];
+                if (count < capacity && request.patienceMs > 0 && now - request.enqueuedMs > request.patienceMs) {
+                    expired[count++] = request;
+                } else {
+                    bucket.requests[(bucket.front + kept++) % MAX_QUEUE_CAPACITY] = request;
+                }
+            }
+            data->size -= bucket.size - kept;
+            bucket.size = kept;
+        }
+    }
+    data->reneged += count;
+
+    unlockQueue();
+    return count;
+}
+
+static void addSample(LatencyHistogram& histogram, long long ms) {
+    ms = std::max(0LL, ms);
+    histogram.buckets[std::min<long long>(ms / LATENCY_BUCKET_MS, LATENCY_BUCKETS - 1)]++;
+    histogram.count++;
+    histogram.maxMs = std::max(histogram.maxMs, ms);
+}
+
+// Upper edge of the bucket holding the given fraction of the samples
+static double percentileSeconds(const LatencyHistogram& histogram, double fraction) {
+    long long rank = static_cast<long long>(fraction * histogram.count + 0.999999);
+    long long seen = 0;
+    for (int b = 0; b < LATENCY_BUCKETS; b++) {
+        seen += histogram.buckets[b];
+        if (seen >= std::max(1LL, rank)) {
+            return std::min<long long>((b + 1) * LATENCY_BUCKET_MS, histogram.maxMs) / 1000.0;
+        }
+    }
+    return histogram.maxMs / 1000.0;
+}
+
+void SharedQueue::recordService(Priority priority, long long waitMs, long long totalMs) {
+    lockQueue();
+    addSample(data->wait[static_cast<int>(priority)], waitMs);
+    addSample(data->total[static_cast<int>(priority)], totalMs);
+    unlockQueue();
+}
+
+void SharedQueue::reportLatency(std::ostream& out) {
+    lockQueue();
+    out << "Latency by class, seconds (p50 / p90 / p99 / max):\n";
+    out << std::fixed << std::setprecision(1);
+    for (int c = 0; c < PRIORITY_COUNT; c++) {
+        const LatencyHistogram& wait = data->wait[c];
+        const LatencyHistogram& total = data->total[c];
+        out << "  " << std::left << std::setw(10) << getPriorityName(static_cast<Priority>(c)) << std::right
+            << std::setw(5) << wait.count << " served";
+        if (wait.count > 0) {
+            out << "  wait " << percentileSeconds(wait, 0.5) << " / " << percentileSeconds(wait, 0.9) << " / "
+                << percentileSeconds(wait, 0.99) << " / " << wait.maxMs / 1000.0
+                << "  total " << percentileSeconds(total, 0.5) << " / " << percentileSeconds(total, 0.9) << " / "
+                << percentileSeconds(total, 0.99) << " / " << total.maxMs / 1000.0;
+        }
+        out << "\n";
+    }
+    unlockQueue();
+}
+
+void SharedQueue::reportAdmission(std::ostream& out) {
+    lockQueue();
+    int offered = 0;
+    for (int outcome : data->outcomes) {
+        offered += outcome;
+    }
+    int served = 0;
+    for (const LatencyHistogram& wait : data->wait) {
+        served += wait.count;
+    }
+    double seconds = (monotonicMs() - data->startMs) / 1000.0;
+
+    out << "Admission policy: " << getAdmissionPolicyName(data->admission.policy) << "\n";
+    out << "  offered " << offered << ", admitted " << data->outcomes[static_cast<int>(Admission::ACCEPTED)]
+        << ", turned away:";
+    for (int a = 1; a < ADMISSION_COUNT; a++) {
+        out << " " << getAdmissionName(static_cast<Admission>(a)) << " " << data->outcomes[a]
+            << (a + 1 < ADMISSION_COUNT ? "," : "\n");
+    }
+    out << "  reneged " << data->reneged << ", left at shutdown " << data->shutdown << "\n";
+    out << std::fixed << std::setprecision(1);
+    out << "  goodput " << served << " served, " << (seconds > 0 ? served / seconds : 0) << " per second, "
+        << (offered > 0 ? 100.0 * served / offered : 0) << "% of offered\n";
+    unlockQueue();
+}
@@ -3,6 +3,10 @@
 #include <sys/ipc.h>
 #include <sys/shm.h>
 #include <sys/sem.h>
+#include <ctime>
+#include <ostream>
+#include <random>
+#include <string_view>
 #include <vector>
 
 enum class FuelType {
@@ -11,7 +15,7 @@ enum class FuelType {
     AI_95
 };
 
-inline std::string getFuelTypeName(FuelType type) {
+inline std::string_view getFuelTypeName(FuelType type) {
     switch (type) {
         case FuelType::AI_76: return "AI-76";
         case FuelType::AI_92: return "AI-92";
@@ -20,26 +24,126 @@ inline std::string getFuelTypeName(FuelType type) {
     }
 }
 
+// Service classes, most urgent first
+enum class Priority {
+    EMERGENCY,
+    FLEET,
+    REGULAR
+};
+
+const int FUEL_TYPE_COUNT = 3;
+const int PRIORITY_COUNT = 3;
+
+inline std::string_view getPriorityName(Priority priority) {
+    switch (priority) {
+        case Priority::EMERGENCY: return "emergency";
+        case Priority::FLEET: return "fleet";
+        case Priority::REGULAR: return "regular";
+        default: return "unknown";
+    }
+}
+
+// Milliseconds on CLOCK_MONOTONIC, which all processes of the simulation share
+inline long long monotonicMs() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<long long>(now.tv_sec) * 1000 + now.tv_nsec / 1000000;
+}
+
 struct Request {
     int id;
     FuelType fuelType;
+    Priority priority;
     time_t timestamp;
+    long long enqueuedMs; // monotonicMs() when the request was generated
+    long long patienceMs; // Waiting time after which the customer leaves; 0 waits as long as it takes
+};
+
+// What the queue does with an arriving request besides the hard limit of
+// MAX_QUEUE_SIZE. Emergency requests are only turned away by the limit.
+enum class AdmissionPolicy {
+    DROP_TAIL,      // Admit until the queue is full
+    FUEL_QUOTA,     // Each fuel lane gets a share of the queue in proportion to its pumps' service rate
+    PREDICTED_WAIT, // Refuse when the predicted wait exceeds maxPredictedWaitMs
+    EARLY_DROP,     // RED: refuse with a probability that grows with the average queue length
+    BALKING         // The customer sees the predicted wait and leaves if it exceeds their patience
 };
 
+inline std::string_view getAdmissionPolicyName(AdmissionPolicy policy) {
+    switch (policy) {
+        case AdmissionPolicy::DROP_TAIL: return "tail";
+        case AdmissionPolicy::FUEL_QUOTA: return "quota";
+        case AdmissionPolicy::PREDICTED_WAIT: return "wait";
+        case AdmissionPolicy::EARLY_DROP: return "red";
+        case AdmissionPolicy::BALKING: return "balk";
+        default: return "unknown";
+    }
+}
+
+struct AdmissionSettings {
+    AdmissionPolicy policy = AdmissionPolicy::DROP_TAIL;
+    int maxPredictedWaitMs = 10000;
+    // RED thresholds on the average queue length, in percent of
+    // MAX_QUEUE_SIZE, and the refusal probability reached at the upper one
+    int redMinPercent = 30;
+    int redMaxPercent = 90;
+    int redMaxDropPercent = 20;
+    // Mean time between two completions of a lane when all its pumps are
+    // busy, from the configured pump means; 0 for a lane without pumps
+    double laneIntervalMs[FUEL_TYPE_COUNT] = {};
+};
+
+// Outcome of SharedQueue::addRequest
+enum class Admission {
+    ACCEPTED,
+    FULL,
+    QUOTA,
+    PREDICTED_WAIT,
+    EARLY_DROP,
+    BALKED
+};
+
+const int ADMISSION_COUNT = 6;
+
+inline std::string_view getAdmissionName(Admission admission) {
+    switch (admission) {
+        case Admission::ACCEPTED: return "accepted";
+        case Admission::FULL: return "full";
+        case Admission::QUOTA: return "fuel quota";
+        case Admission::PREDICTED_WAIT: return "predicted wait";
+        case Admission::EARLY_DROP: return "early drop";
+        case Admission::BALKED: return "balked";
+        default: return "unknown";
+    }
+}
+
 class SharedQueue {
 public:
-    SharedQueue(int maxSize);
+    // agingMs: waiting time that raises a request by one priority class
+    SharedQueue(int maxSize, int agingMs, const AdmissionSettings& admission);
     ~SharedQueue();
     
-    bool addRequest(const Request& request);
+    Admission addRequest(const Request& request);
     bool getRequest(int stationId, FuelType stationFuelType, Request& request);
     int getCurrentSize() const;
     void cleanupRemainingRequests();
+
+    // Removes requests whose customers ran out of patience from every lane
+    // and copies up to capacity of them to expired; returns how many
+    int removeExpired(Request* expired, int capacity);
+
+    // Waiting time in the queue and time until the end of service of a
+    // serviced request, kept per class in the shared segment
+    void recordService(Priority priority, long long waitMs, long long totalMs);
+    void reportLatency(std::ostream& out);
+    // Offered and admitted requests, why the others were lost and the goodput
+    void reportAdmission(std::ostream& out);
     
 private:
     int shmId;
     int semId;
     struct QueueData* data;
+    std::minstd_rand random; // Used by the generator process only, for early drops
     void lockQueue();
     void unlockQueue();
     void initializeSemaphore();
@@ -18,8 +18,7 @@ ServiceStation::ServiceStation(SharedQueue& q, int id, const Config& c)
     std::ostringstream oss;
     oss << "logs/station_" << stationId << ".log";
     logFile = oss.str();
-    std::ofstream log(logFile, std::ios::trunc);
-    log.close();
+    log.open(logFile, std::ios::trunc);
 }
 
 void ServiceStation::run() {
@@ -35,29 +34,38 @@ void ServiceStation::run() {
     );
 
     std::this_thread::sleep_for(std::chrono::milliseconds(50 * stationId));
+    TimestampCache timestamps;
+    const int EXPIRED_BATCH = 8;
+    Request expired[EXPIRED_BATCH];
     
     while (running) {
+        // Customers who ran out of patience leave before the next one is taken
+        int count;
+        do {
+            count = queue.removeExpired(expired, EXPIRED_BATCH);
+            for (int i = 0; i < count; i++) {
+                Logger::logReneged(log, expired[i].id,
+                                 getFuelTypeName(expired[i].fuelType),
+                                 static_cast<int>(monotonicMs() - expired[i].enqueuedMs),
+                                 timestamps.format(std::time(nullptr)));
+            }
+        } while (count == EXPIRED_BATCH);
+
         Request request;
         if (queue.getRequest(stationId, fuelType, request)) {
-            std::string timestamp = std::ctime(&request.timestamp);
-            timestamp = timestamp.substr(0, timestamp.length() - 1);
-            
-            std::ofstream log(logFile, std::ios::app);
+            long long waitMs = monotonicMs() - request.enqueuedMs;
             Logger::logQueueRemoval(log, stationId, request.id,
                                   getFuelTypeName(request.fuelType),
                                   queue.getCurrentSize(),
-                                  timestamp);
+                                  timestamps.format(request.timestamp));
             
             int serviceDelay = std::max(100, static_cast<int>(service_time(gen)));
             std::this_thread::sleep_for(std::chrono::milliseconds(serviceDelay));
             
-            timestamp = std::ctime(&request.timestamp);
-            timestamp = timestamp.substr(0, timestamp.length() - 1);
-            
             Logger::logService(log, stationId, request.id,
                              getFuelTypeName(request.fuelType),
-                             timestamp);
-            log.close();
+                             timestamps.format(request.timestamp));
+            queue.recordService(request.priority, waitMs, monotonicMs() - request.enqueuedMs);
         } else {
             std::this_thread::sleep_for(std::chrono::milliseconds(200));
         }
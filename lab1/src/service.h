@@ -1,6 +1,7 @@
 #pragma once
 #include "queue.h"
 #include "config.h"
+#include <fstream>
 #include <string>
 
 class ServiceStation {
@@ -13,6 +14,7 @@ private:
     int stationId;
     const Config& config;
     std::string logFile;
+    std::ofstream log; // Open for the life of the process
     FuelType fuelType;
     
     void logService(const Request& request);
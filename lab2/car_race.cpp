@@ -6,31 +6,223 @@
 #include <cstring>
 #include <sys/wait.h>
 #include <errno.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <climits>
 
 int semid = -1;
 int progressQueueId = -1;
 int resultQueueId = -1;
+int raceEventFd = -1; // Cars bump it on every progress or finish, the referee sleeps on it
+int clockShmId = -1;
+RaceClock* raceClock = nullptr;
 
 void clearScreen() {
     std::cout << "\033[2J\033[1;1H";
 }
 
-void displayTrack(const std::vector<int>& positions) {
-    for (int car = 1; car <= CarRace::NUM_CARS; car++) {
-        std::cout << "Car " << car << " [";
-        int pos = positions[car];
-        for (int i = 0; i < CarRace::TRACK_LENGTH; i++) {
-            if (i == pos) {
-                std::cout << "🏎️ ";
-            } else if (i == CarRace::TRACK_LENGTH - 1) {
-                std::cout << "🏁";
-            } else {
-                std::cout << "-";
-            }
-        }
-        std::cout << "]\n";
+static const int TRACK_FIRST_ROW = 4; // Screen row of car 1 below the stage header
+
+static const char* trackCell(int i, int pos) {
+    if (i == pos) {
+        return "🏎️ ";
+    } else if (i == CarRace::TRACK_LENGTH - 1) {
+        return "🏁";
     }
+    return "-";
+}
+
+TrackRenderer::TrackRenderer(int numCars)
+    : numCars(numCars), drawn(numCars + 1, 0) {}
+
+void TrackRenderer::beginStage(int stage) {
     std::cout << std::flush;
+    frame = "\033[2J\033[1;1H\n=== Stage " + std::to_string(stage + 1) + " ===\n\n";
+    std::fill(drawn.begin(), drawn.end(), 0);
+    for (int car = 1; car <= numCars; car++) {
+        appendCells(car, 0, 0);
+    }
+    flush();
+}
+
+void TrackRenderer::update(const std::vector<int>& positions) {
+    for (int car = 1; car <= numCars; car++) {
+        if (positions[car] != drawn[car]) {
+            // The car glyph is wider than a track cell, so everything from
+            // the first changed cell to the end of the row has to move.
+            appendCells(car, std::min(drawn[car], positions[car]), positions[car]);
+            drawn[car] = positions[car];
+        }
+    }
+    if (!frame.empty()) {
+        frame += "\033[" + std::to_string(TRACK_FIRST_ROW + numCars) + ";1H";
+        flush();
+    }
+}
+
+void TrackRenderer::appendCells(int car, int from, int pos) {
+    std::string prefix = "Car " + std::to_string(car) + " [";
+    int column = from == 0 ? 1 : static_cast<int>(prefix.size()) + from + 1;
+    frame += "\033[" + std::to_string(TRACK_FIRST_ROW + car - 1) + ";" + std::to_string(column) + "H";
+    if (from == 0) {
+        frame += prefix;
+    }
+    for (int i = from; i < CarRace::TRACK_LENGTH; i++) {
+        frame += trackCell(i, pos);
+    }
+    frame += "]\033[K";
+}
+
+void TrackRenderer::flush() {
+    const char* data = frame.data();
+    size_t left = frame.size();
+    while (left > 0) {
+        ssize_t written = write(STDOUT_FILENO, data, left);
+        if (written == -1) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        data += written;
+        left -= written;
+    }
+    frame.clear();
+}
+
+RaceOptions parseRaceOptions(int argc, char** argv) {
+    RaceOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg == "headless") {
+            options.headless = true;
+        } else if (arg.rfind("min_delay=", 0) == 0) {
+            options.minDelayMs = std::atoi(arg.c_str() + 10);
+        } else if (arg.rfind("max_delay=", 0) == 0) {
+            options.maxDelayMs = std::atoi(arg.c_str() + 10);
+        } else if (arg.rfind("cars=", 0) == 0) {
+            options.numCars = std::atoi(arg.c_str() + 5);
+        } else if (arg.rfind("lead=", 0) == 0) {
+            options.startLeadMs = std::atoi(arg.c_str() + 5);
+        } else if (arg.rfind("seed=", 0) == 0) {
+            options.seed = std::strtoul(arg.c_str() + 5, nullptr, 10);
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [headless] [min_delay=MS] [max_delay=MS]"
+                      << " [cars=N] [lead=MS] [seed=N]\n";
+            exit(1);
+        }
+    }
+    if (options.minDelayMs < 0 || options.maxDelayMs < options.minDelayMs) {
+        std::cerr << "Invalid delay range " << options.minDelayMs << ".." << options.maxDelayMs << " ms\n";
+        exit(1);
+    }
+    if (options.numCars < 1 || options.startLeadMs < 0) {
+        std::cerr << "Need at least one car and a non-negative start lead\n";
+        exit(1);
+    }
+    return options;
+}
+
+// Wakes the referee; the counter value itself is not used.
+static void notifyReferee() {
+    uint64_t one = 1;
+    while (write(raceEventFd, &one, sizeof(one)) == -1 && errno == EINTR) {}
+}
+
+// Blocks until a car posts an event or timeoutMs elapses (-1 waits forever).
+static bool waitForRaceEvent(int timeoutMs) {
+    struct pollfd pfd = {raceEventFd, POLLIN, 0};
+    int ready = poll(&pfd, 1, timeoutMs);
+    if (ready > 0) {
+        uint64_t events;
+        if (read(raceEventFd, &events, sizeof(events)) == -1 && errno != EAGAIN) {
+            perror("read race events failed");
+        }
+        return true;
+    }
+    if (ready == -1 && errno != EINTR) {
+        perror("poll failed");
+        exit(1);
+    }
+    return false;
+}
+
+// All race timestamps come from CLOCK_MONOTONIC, which every process on
+// the host shares.
+static long long monotonicNowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void sleepUntilNs(long long deadlineNs) {
+    struct timespec ts = {static_cast<time_t>(deadlineNs / 1000000000LL),
+                          static_cast<long>(deadlineNs % 1000000000LL)};
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {}
+}
+
+void printStageSummary(const std::vector<StageStats>& stats) {
+    StageStats total;
+    std::cout << "\nHeadless Run Summary:\n";
+    std::cout << "Stage | Wall time (s) | Progress msgs | Result msgs | Wakeups | Frames | Detect (ms) | Msgs/s\n";
+    std::cout << "------|---------------|---------------|-------------|---------|--------|-------------|---------\n";
+    for (size_t i = 0; i < stats.size(); i++) {
+        const StageStats& s = stats[i];
+        std::cout << std::setw(6) << i + 1 << "|"
+                  << std::setw(15) << std::fixed << std::setprecision(3) << s.wallTime << "|"
+                  << std::setw(15) << s.progressMsgs << "|"
+                  << std::setw(13) << s.resultMsgs << "|"
+                  << std::setw(9) << s.wakeups << "|"
+                  << std::setw(8) << s.frames << "|"
+                  << std::setw(13) << s.detectLatency * 1000 << "|"
+                  << std::setw(9) << std::setprecision(1)
+                  << (s.progressMsgs + s.resultMsgs) / s.wallTime << "\n";
+        total.wallTime += s.wallTime;
+        total.progressMsgs += s.progressMsgs;
+        total.resultMsgs += s.resultMsgs;
+        total.wakeups += s.wakeups;
+        total.frames += s.frames;
+        total.detectLatency = std::max(total.detectLatency, s.detectLatency);
+    }
+    std::cout << " Total|"
+              << std::setw(15) << std::setprecision(3) << total.wallTime << "|"
+              << std::setw(15) << total.progressMsgs << "|"
+              << std::setw(13) << total.resultMsgs << "|"
+              << std::setw(9) << total.wakeups << "|"
+              << std::setw(8) << total.frames << "|"
+              << std::setw(13) << total.detectLatency * 1000 << "|"
+              << std::setw(9) << std::setprecision(1)
+              << (total.progressMsgs + total.resultMsgs) / total.wallTime << "\n";
+}
+
+void printJitterReport(const RaceOptions& options, const std::vector<StageStats>& stats) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    double oversubscription = static_cast<double>(options.numCars + 1) / cpus;
+    StageStats worst;
+
+    std::cout << "\nStart Jitter (cars " << options.numCars << ", cpus " << cpus
+              << ", lead " << options.startLeadMs << " ms, seed " << options.seed << "):\n";
+    std::cout << "Stage | Wake max (ms) | Wake spread (ms) | Start skew (ms) | Late starts\n";
+    std::cout << "------|---------------|------------------|-----------------|------------\n";
+    for (size_t i = 0; i < stats.size(); i++) {
+        const StageStats& s = stats[i];
+        std::cout << std::setw(6) << i + 1 << "|"
+                  << std::setw(15) << std::fixed << std::setprecision(3) << s.wakeDelayMax * 1000 << "|"
+                  << std::setw(18) << s.wakeSpread * 1000 << "|"
+                  << std::setw(17) << s.startSkewMax * 1000 << "|"
+                  << std::setw(12) << s.lateStarts << "\n";
+        worst.wakeDelayMax = std::max(worst.wakeDelayMax, s.wakeDelayMax);
+        worst.wakeSpread = std::max(worst.wakeSpread, s.wakeSpread);
+        worst.startSkewMax = std::max(worst.startSkewMax, s.startSkewMax);
+        worst.lateStarts += s.lateStarts;
+    }
+    // One greppable line per run so sweeps over cars= can be tabulated
+    std::cout << "Jitter: cars=" << options.numCars
+              << " cpus=" << cpus
+              << " oversubscription=" << std::setprecision(2) << oversubscription
+              << " wake_max_ms=" << std::setprecision(3) << worst.wakeDelayMax * 1000
+              << " wake_spread_ms=" << worst.wakeSpread * 1000
+              << " start_skew_ms=" << worst.startSkewMax * 1000
+              << " late_starts=" << worst.lateStarts << "\n";
 }
 
 void initializeIPC() {
@@ -51,6 +243,24 @@ void initializeIPC() {
     
     msgctl(resultQueueId, IPC_RMID, NULL);
     resultQueueId = msgget(CarRace::RESULT_QUEUE_KEY, IPC_CREAT | 0666);
+
+    clockShmId = shmget(CarRace::CLOCK_SHM_KEY, sizeof(RaceClock), IPC_CREAT | 0666);
+    if (clockShmId == -1) {
+        perror("shmget failed");
+        exit(1);
+    }
+    raceClock = static_cast<RaceClock*>(shmat(clockShmId, nullptr, 0));
+    if (raceClock == reinterpret_cast<RaceClock*>(-1)) {
+        perror("shmat failed");
+        exit(1);
+    }
+
+    // Created before fork() so every car inherits the same counter
+    raceEventFd = eventfd(0, EFD_NONBLOCK);
+    if (raceEventFd == -1) {
+        perror("eventfd failed");
+        exit(1);
+    }
 }
 
 void cleanupIPC() {
@@ -63,9 +273,18 @@ void cleanupIPC() {
     if (resultQueueId != -1) {
         msgctl(resultQueueId, IPC_RMID, NULL);
     }
+    if (raceEventFd != -1) {
+        close(raceEventFd);
+    }
+    if (raceClock != nullptr) {
+        shmdt(raceClock);
+    }
+    if (clockShmId != -1) {
+        shmctl(clockShmId, IPC_RMID, nullptr);
+    }
 }
 
-void runCarProcess(int carId) {
+void runCarProcess(int carId, const RaceOptions& options) {
     struct sembuf ops;
     
     for (int stage = 0; stage < CarRace::NUM_STAGES; stage++) {
@@ -75,19 +294,28 @@ void runCarProcess(int carId) {
         ops.sem_flg = 0;
         semop(semid, &ops, 1);
         
-        auto startTime = std::chrono::high_resolution_clock::now();
-        int raceDelay = CarRace::generateRaceDelay(1000, 5000);
-        int stepDelay = raceDelay / CarRace::TRACK_LENGTH;
+        long long wakeNs = monotonicNowNs();
+        
+        // Everybody leaves the line at the published start, not when they woke up
+        long long startNs = raceClock->startNs;
+        sleepUntilNs(startNs);
+        long long startedNs = monotonicNowNs();
+
+        int raceDelay = CarRace::generateRaceDelay(options.seed, carId, stage,
+                                                   options.minDelayMs, options.maxDelayMs);
+        long long stepNs = raceDelay * 1000000LL / CarRace::TRACK_LENGTH;
         
         for (int progress = 0; progress <= CarRace::TRACK_LENGTH; progress++) {
             ProgressMsg msg = {carId, progress};
             msgsnd(progressQueueId, &msg, sizeof(msg) - sizeof(long), 0);
-            usleep(stepDelay * 1000);
+            notifyReferee();
+            // Steps are scheduled on the shared clock, so a late wakeup is caught up
+            sleepUntilNs(startNs + (progress + 1) * stepNs);
         }
         
-        auto endTime = std::chrono::high_resolution_clock::now();
-        double stageTime = std::chrono::duration<double>(endTime - startTime).count();
-        ResultMsg resultMsg = {carId, stageTime};
+        long long finishNs = monotonicNowNs();
+        double stageTime = (finishNs - startNs) / 1e9;
+        ResultMsg resultMsg = {carId, stageTime, wakeNs, startedNs, finishNs};
         msgsnd(resultQueueId, &resultMsg, sizeof(resultMsg) - sizeof(long), 0);
 
         //from car finish the race
@@ -95,62 +323,106 @@ void runCarProcess(int carId) {
         ops.sem_op = 1;
         ops.sem_flg = 0;
         semop(semid, &ops, 1);
+        notifyReferee();
     }
 }
 
-void runRefereeProcess() {
-    std::vector<RaceResult> results(CarRace::NUM_CARS);
-    std::vector<int> totalPoints(CarRace::NUM_CARS + 1, 0);
+void runRefereeProcess(const RaceOptions& options) {
+    const int numCars = options.numCars;
+    std::vector<RaceResult> results(numCars);
+    std::vector<int> totalPoints(numCars + 1, 0);
+    std::vector<StageStats> stageStats(CarRace::NUM_STAGES);
+    TrackRenderer renderer(numCars);
     
     for (int stage = 0; stage < CarRace::NUM_STAGES; stage++) {
-        std::vector<int> positions(CarRace::NUM_CARS + 1, 0);
+        std::vector<int> positions(numCars + 1, 0);
+        StageStats& stats = stageStats[stage];
         
-        clearScreen();
-        std::cout << "\n=== Stage " << stage + 1 << " ===\n\n";
-        displayTrack(positions);
+        if (!options.headless) {
+            renderer.beginStage(stage);
+        }
         //reset the finish count
         semctl(semid, CarRace::SEM_FINISH, SETVAL, 0);
         
-        //from referee start the race
+        //publish the start line, then from referee start the race
+        long long releaseNs = monotonicNowNs();
+        raceClock->releaseNs = releaseNs;
+        raceClock->startNs = releaseNs + options.startLeadMs * 1000000LL;
         struct sembuf ops; 
         ops.sem_num = CarRace::SEM_START;
-        ops.sem_op = CarRace::NUM_CARS;
+        ops.sem_op = numCars;
         ops.sem_flg = 0;
         semop(semid, &ops, 1);
         
         bool raceComplete = false;
+        bool dirty = false;
+        long long detectedNs = 0;
+        auto lastFrame = std::chrono::steady_clock::now();
         while (!raceComplete) {
-            for (int car = 1; car <= CarRace::NUM_CARS; car++) {
-                ProgressMsg msg;
-                //from car receive the progress
-                if (msgrcv(progressQueueId, &msg, sizeof(msg) - sizeof(long), car, IPC_NOWAIT) != -1) {
-                    positions[car] = msg.progress;
-                }
+            // Only a pending redraw needs a timeout, otherwise sleep until a car posts
+            int timeoutMs = -1;
+            if (dirty && !options.headless) {
+                auto nextFrame = lastFrame + std::chrono::milliseconds(CarRace::FRAME_INTERVAL_MS);
+                timeoutMs = std::max<long long>(0, std::chrono::duration_cast<std::chrono::milliseconds>(
+                    nextFrame - std::chrono::steady_clock::now()).count());
             }
+            if (waitForRaceEvent(timeoutMs)) {
+                stats.wakeups++;
 
-            clearScreen();
-            std::cout << "\n=== Stage " << stage + 1 << " ===\n\n";
-            displayTrack(positions);
-            usleep(50000);
+                //check if all cars finished the race; their last progress is already queued
+                int finishCount = semctl(semid, CarRace::SEM_FINISH, GETVAL, 0);
+                if (finishCount >= numCars) {
+                    raceComplete = true;
+                    detectedNs = monotonicNowNs();
+                }
+
+                for (int car = 1; car <= numCars; car++) {
+                    ProgressMsg msg;
+                    //from car receive the progress, keeping only the latest one
+                    while (msgrcv(progressQueueId, &msg, sizeof(msg) - sizeof(long), car, IPC_NOWAIT) != -1) {
+                        dirty = dirty || positions[car] != msg.progress;
+                        positions[car] = msg.progress;
+                        stats.progressMsgs++;
+                    }
+                }
+            }
 
-            //check if all cars finished the race
-            int finishCount = semctl(semid, CarRace::SEM_FINISH, GETVAL, 0);
-            if (finishCount >= CarRace::NUM_CARS) {
-                raceComplete = true;
+            auto now = std::chrono::steady_clock::now();
+            if (dirty && !options.headless &&
+                (raceComplete || now - lastFrame >= std::chrono::milliseconds(CarRace::FRAME_INTERVAL_MS))) {
+                renderer.update(positions);
+                stats.frames++;
+                lastFrame = now;
+                dirty = false;
             }
         }
 
-        for (int i = 1; i <= CarRace::NUM_CARS; i++) {
+        long long lastFinishNs = 0;
+        long long firstWakeNs = LLONG_MAX, lastWakeNs = 0, lastStartedNs = 0;
+        for (int i = 1; i <= numCars; i++) {
             ResultMsg resultMsg;
             
             if (msgrcv(resultQueueId, &resultMsg, sizeof(resultMsg) - sizeof(long), i, 0) == -1) {
                 perror("msgrcv failed for result");
                 exit(1);
             }
+            stats.resultMsgs++;
+            lastFinishNs = std::max(lastFinishNs, resultMsg.finishNs);
+            firstWakeNs = std::min(firstWakeNs, resultMsg.wakeNs);
+            lastWakeNs = std::max(lastWakeNs, resultMsg.wakeNs);
+            lastStartedNs = std::max(lastStartedNs, resultMsg.startedNs);
+            if (resultMsg.wakeNs > raceClock->startNs) {
+                stats.lateStarts++;
+            }
             
             results[i-1].carId = i;
             results[i-1].stageTime = resultMsg.stageTime;
         }
+        stats.detectLatency = std::max(0LL, detectedNs - lastFinishNs) / 1e9;
+        stats.wallTime = (monotonicNowNs() - releaseNs) / 1e9;
+        stats.wakeDelayMax = (lastWakeNs - releaseNs) / 1e9;
+        stats.wakeSpread = (lastWakeNs - firstWakeNs) / 1e9;
+        stats.startSkewMax = std::max(0LL, lastStartedNs - raceClock->startNs) / 1e9;
 
         std::sort(results.begin(), results.end(),
                  [](const RaceResult& a, const RaceResult& b) {
@@ -161,9 +433,9 @@ void runRefereeProcess() {
         std::cout << "Position | Car ID | Time (s) | Points\n";
         std::cout << "---------|---------|----------|--------\n";
 
-        for (int i = 0; i < CarRace::NUM_CARS; i++) {
+        for (int i = 0; i < numCars; i++) {
             results[i].position = i + 1;
-            results[i].points = CarRace::POINTS[i];
+            results[i].points = CarRace::pointsFor(i + 1);
             totalPoints[results[i].carId] += results[i].points;
 
             std::cout << std::setw(9) << results[i].position << "|"
@@ -173,17 +445,24 @@ void runRefereeProcess() {
                      << std::setw(8) << results[i].points << "\n";
         }
         
-        std::cout << "\nPress Enter to continue...";
-        std::cin.get();
+        if (!options.headless) {
+            std::cout << "\nPress Enter to continue...";
+            std::cin.get();
+        }
     }
 
-    clearScreen();
+    if (options.headless) {
+        printStageSummary(stageStats);
+        printJitterReport(options, stageStats);
+    } else {
+        clearScreen();
+    }
     std::cout << "\nFinal Standings:\n";
     std::cout << "Car ID | Total Points\n";
     std::cout << "--------|-------------\n";
     
     std::vector<std::pair<int, int>> standings;
-    for (int i = 1; i <= CarRace::NUM_CARS; i++) {
+    for (int i = 1; i <= numCars; i++) {
         standings.push_back({i, totalPoints[i]});
     }
     
@@ -20,6 +20,16 @@ struct ProgressMsg {
 struct ResultMsg {
     long mtype;      // Message type (car ID)
     double stageTime; // Time taken to complete the stage
+    long long wakeNs;   // CLOCK_MONOTONIC when the car returned from SEM_START
+    long long startedNs; // When the car actually left the line
+    long long finishNs; // When the car crossed the line
+};
+
+// Published by the referee in shared memory before releasing SEM_START.
+// All cars start at startNs and measure their finish against it.
+struct RaceClock {
+    long long releaseNs; // When SEM_START was raised
+    long long startNs;   // Common start line, releaseNs + the start lead
 };
 
 struct RaceResult {
@@ -29,6 +39,24 @@ struct RaceResult {
     int points;
 };
 
+// Keeps the last drawn car positions and only rewrites rows that changed.
+// A frame is composed into one buffer and sent with a single write().
+class TrackRenderer {
+public:
+    explicit TrackRenderer(int numCars);
+
+    void beginStage(int stage);
+    void update(const std::vector<int>& positions);
+
+private:
+    int numCars;
+    std::vector<int> drawn;
+    std::string frame;
+
+    void appendCells(int car, int from, int pos);
+    void flush();
+};
+
 class CarRace {
 public:
     static const int NUM_CARS = 5;
@@ -41,19 +69,56 @@ public:
     static const key_t SEM_KEY = 0x1234;
     static const key_t PROGRESS_QUEUE_KEY = 0x2345;
     static const key_t RESULT_QUEUE_KEY = 0x3456;
+    static const key_t CLOCK_SHM_KEY = 0x4567;
     
     static const int SEM_START = 0;  // Used to signal race start
     static const int SEM_FINISH = 1; // Used to count finished cars
 
-    static int generateRaceDelay(int minMs, int maxMs) {
-        static std::mt19937 rng(std::chrono::steady_clock::now().time_since_epoch().count());
+    static constexpr int FRAME_INTERVAL_MS = 50; // Upper bound on the display rate
+    static const int START_LEAD_MS = 20;         // Release to start line by default
+
+    static int pointsFor(int position) {
+        return position <= 5 ? POINTS[position - 1] : 0;
+    }
+
+    // Every car draws from its own stream derived from the race seed, so a
+    // stage does not depend on when or in which order processes were forked.
+    static int generateRaceDelay(unsigned int seed, int carId, int stage, int minMs, int maxMs) {
+        std::seed_seq seq{seed, static_cast<unsigned int>(carId), static_cast<unsigned int>(stage)};
+        std::mt19937 rng(seq);
         std::uniform_int_distribution<int> dist(minMs, maxMs);
         return dist(rng);
     }
 };
 
-void runRefereeProcess();
-void runCarProcess(int carId);
+struct RaceOptions {
+    bool headless = false; // No rendering and no pauses between stages
+    int minDelayMs = 1000;
+    int maxDelayMs = 5000;
+    int numCars = CarRace::NUM_CARS;
+    int startLeadMs = CarRace::START_LEAD_MS;
+    unsigned int seed = std::random_device{}();
+};
+
+struct StageStats {
+    double wallTime = 0;   // Start signal to last result received
+    long progressMsgs = 0; // Progress messages drained by the referee
+    long resultMsgs = 0;
+    long wakeups = 0;      // Referee returns from waiting on the event fd
+    long frames = 0;       // Frames actually rendered
+    double detectLatency = 0; // Last car finished to referee noticing it
+    double wakeDelayMax = 0;  // Latest SEM_START wakeup after the release
+    double wakeSpread = 0;    // Latest minus earliest wakeup
+    double startSkewMax = 0;  // Latest actual start after the published start
+    int lateStarts = 0;       // Cars that woke after the published start
+};
+
+RaceOptions parseRaceOptions(int argc, char** argv);
+void printStageSummary(const std::vector<StageStats>& stats);
+void printJitterReport(const RaceOptions& options, const std::vector<StageStats>& stats);
+
+void runRefereeProcess(const RaceOptions& options);
+void runCarProcess(int carId, const RaceOptions& options);
 void initializeIPC();
 void cleanupIPC();
 void clearMessageQueue(int qid);
@@ -4,23 +4,24 @@
 #include <sys/wait.h>
 #include <vector>
 
-int main() {
+int main(int argc, char** argv) {
+    RaceOptions options = parseRaceOptions(argc, argv);
     initializeIPC();
     
     std::vector<pid_t> carProcesses;
     
-    for (int i = 1; i <= CarRace::NUM_CARS; i++) {
+    for (int i = 1; i <= options.numCars; i++) {
         pid_t pid = fork();
         
         if (pid == 0) {
-            runCarProcess(i);
+            runCarProcess(i, options);
             exit(0);
         } else {
             carProcesses.push_back(pid);
         }
     }
     
-    runRefereeProcess();
+    runRefereeProcess(options);
     
     for (pid_t pid : carProcesses) {
         waitpid(pid, NULL, 0);
@@ -3,51 +3,253 @@
 #include <algorithm>
 #include <iomanip>
 #include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <climits>
 
 
 void clearScreen() {
     std::cout << "\033[2J\033[1;1H";
 }
 
-void displayTrack(const std::vector<int>& positions) {
-    for (int car = 1; car <= CarRace::NUM_CARS; car++) {
-        std::cout << "Car " << car << " [";
-        int pos = positions[car];
-        for (int i = 0; i < CarRace::TRACK_LENGTH; i++) {
-            if (i == pos) {
-                std::cout << "🏎️ ";
-            } else if (i == CarRace::TRACK_LENGTH - 1) {
-                std::cout << "🏁";
-            } else {
-                std::cout << "-";
+static const int TRACK_FIRST_ROW = 4; // Screen row of car 1 below the stage header
+
+static const char* trackCell(int i, int pos) {
+    if (i == pos) {
+        return "🏎️ ";
+    } else if (i == CarRace::TRACK_LENGTH - 1) {
+        return "🏁";
+    }
+    return "-";
+}
+
+TrackRenderer::TrackRenderer(int numCars)
+    : numCars(numCars), drawn(numCars + 1, 0) {}
+
+void TrackRenderer::beginStage(int stage) {
+    std::cout << std::flush;
+    frame = "\033[2J\033[1;1H\n=== Stage " + std::to_string(stage + 1) + " ===\n\n";
+    std::fill(drawn.begin(), drawn.end(), 0);
+    for (int car = 1; car <= numCars; car++) {
+        appendCells(car, 0, 0);
+    }
+    flush();
+}
+
+void TrackRenderer::update(const std::vector<int>& positions) {
+    for (int car = 1; car <= numCars; car++) {
+        if (positions[car] != drawn[car]) {
+            // The car glyph is wider than a track cell, so everything from
+            // the first changed cell to the end of the row has to move.
+            appendCells(car, std::min(drawn[car], positions[car]), positions[car]);
+            drawn[car] = positions[car];
+        }
+    }
+    if (!frame.empty()) {
+        frame += "\033[" + std::to_string(TRACK_FIRST_ROW + numCars) + ";1H";
+        flush();
+    }
+}
+
+void TrackRenderer::appendCells(int car, int from, int pos) {
+    std::string prefix = "Car " + std::to_string(car) + " [";
+    int column = from == 0 ? 1 : static_cast<int>(prefix.size()) + from + 1;
+    frame += "\033[" + std::to_string(TRACK_FIRST_ROW + car - 1) + ";" + std::to_string(column) + "H";
+    if (from == 0) {
+        frame += prefix;
+    }
+    for (int i = from; i < CarRace::TRACK_LENGTH; i++) {
+        frame += trackCell(i, pos);
+    }
+    frame += "]\033[K";
+}
+
+void TrackRenderer::flush() {
+    const char* data = frame.data();
+    size_t left = frame.size();
+    while (left > 0) {
+        ssize_t written = write(STDOUT_FILENO, data, left);
+        if (written == -1) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        data += written;
+        left -= written;
+    }
+    frame.clear();
+}
+
+// Race timestamps come from CLOCK_MONOTONIC; cars translate them to the
+// referee's clock with the offset measured by syncClockWithReferee().
+static long long monotonicNowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void sleepUntilNs(long long deadlineNs) {
+    struct timespec ts = {static_cast<time_t>(deadlineNs / 1000000000LL),
+                          static_cast<long>(deadlineNs % 1000000000LL)};
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {}
+}
+
+// Cristian's algorithm: keep the round trip with the lowest latency and
+// assume the referee read its clock halfway through it. Returns the value
+// to add to a local timestamp to get referee time.
+static long long syncClockWithReferee() {
+    long long bestRtt = LLONG_MAX, offset = 0;
+    for (int round = 0; round < CarRace::CLOCK_SYNC_ROUNDS; round++) {
+        long long refereeNs;
+        long long sentNs = monotonicNowNs();
+        MPI_Send(&sentNs, 1, MPI_LONG_LONG, CarRace::REFEREE_RANK, CarRace::CLOCK_TAG, MPI_COMM_WORLD);
+        MPI_Recv(&refereeNs, 1, MPI_LONG_LONG, CarRace::REFEREE_RANK, CarRace::CLOCK_TAG,
+                 MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        long long receivedNs = monotonicNowNs();
+        if (receivedNs - sentNs < bestRtt) {
+            bestRtt = receivedNs - sentNs;
+            offset = refereeNs - (sentNs + receivedNs) / 2;
+        }
+    }
+    return offset;
+}
+
+static void serveClockSync(int numCars) {
+    for (int car = 1; car <= numCars; car++) {
+        for (int round = 0; round < CarRace::CLOCK_SYNC_ROUNDS; round++) {
+            long long carNs;
+            MPI_Recv(&carNs, 1, MPI_LONG_LONG, car, CarRace::CLOCK_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            long long refereeNs = monotonicNowNs();
+            MPI_Send(&refereeNs, 1, MPI_LONG_LONG, car, CarRace::CLOCK_TAG, MPI_COMM_WORLD);
+        }
+    }
+}
+
+bool parseRaceOptions(int argc, char** argv, int first, RaceOptions& options) {
+    for (int i = first; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg == "headless") {
+            options.headless = true;
+        } else if (arg.rfind("min_delay=", 0) == 0) {
+            options.minDelayMs = std::atoi(arg.c_str() + 10);
+        } else if (arg.rfind("max_delay=", 0) == 0) {
+            options.maxDelayMs = std::atoi(arg.c_str() + 10);
+        } else if (arg.rfind("lead=", 0) == 0) {
+            options.startLeadMs = std::atoi(arg.c_str() + 5);
+        } else if (arg.rfind("seed=", 0) == 0) {
+            options.seed = std::strtoul(arg.c_str() + 5, nullptr, 10);
+        } else if (arg.rfind("progress=", 0) == 0) {
+            if (!parseProgressMode(arg.substr(9), options.progressMode)) {
+                return false;
             }
+        } else {
+            return false;
         }
-        std::cout << "]\n";
     }
-    std::cout << std::flush;
+    return options.minDelayMs >= 0 && options.maxDelayMs >= options.minDelayMs &&
+           options.startLeadMs >= 0;
 }
 
-void runCarProcess(int rank) {
+void printStageSummary(const RaceOptions& options, const std::vector<StageStats>& stats) {
+    StageStats total;
+    std::cout << "\nHeadless Run Summary (progress=" << progressModeName(options.progressMode) << "):\n";
+    std::cout << "Stage | Wall time (s) | Car updates | Received | Result msgs | Frames | Msgs/s\n";
+    std::cout << "------|---------------|-------------|----------|-------------|--------|---------\n";
+    for (size_t i = 0; i < stats.size(); i++) {
+        const StageStats& s = stats[i];
+        std::cout << std::setw(6) << i + 1 << "|"
+                  << std::setw(15) << std::fixed << std::setprecision(3) << s.wallTime << "|"
+                  << std::setw(13) << s.carUpdates << "|"
+                  << std::setw(10) << s.progressMsgs << "|"
+                  << std::setw(13) << s.resultMsgs << "|"
+                  << std::setw(8) << s.frames << "|"
+                  << std::setw(9) << std::setprecision(1)
+                  << (s.progressMsgs + s.resultMsgs) / s.wallTime << "\n";
+        total.wallTime += s.wallTime;
+        total.carUpdates += s.carUpdates;
+        total.progressMsgs += s.progressMsgs;
+        total.resultMsgs += s.resultMsgs;
+        total.frames += s.frames;
+    }
+    std::cout << " Total|"
+              << std::setw(15) << std::setprecision(3) << total.wallTime << "|"
+              << std::setw(13) << total.carUpdates << "|"
+              << std::setw(10) << total.progressMsgs << "|"
+              << std::setw(13) << total.resultMsgs << "|"
+              << std::setw(8) << total.frames << "|"
+              << std::setw(9) << std::setprecision(1)
+              << (total.progressMsgs + total.resultMsgs) / total.wallTime << "\n";
+}
+
+void printJitterReport(const RaceOptions& options, const std::vector<StageStats>& stats) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN); // This host only
+    int ranks;
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+    double oversubscription = static_cast<double>(ranks) / cpus;
+    StageStats worst;
+
+    std::cout << "\nStart Jitter (cars " << options.numCars << ", cpus " << cpus
+              << ", lead " << options.startLeadMs << " ms, seed " << options.seed << "):\n";
+    std::cout << "Stage | Wake max (ms) | Wake spread (ms) | Start skew (ms) | Late starts\n";
+    std::cout << "------|---------------|------------------|-----------------|------------\n";
+    for (size_t i = 0; i < stats.size(); i++) {
+        const StageStats& s = stats[i];
+        std::cout << std::setw(6) << i + 1 << "|"
+                  << std::setw(15) << std::fixed << std::setprecision(3) << s.wakeDelayMax * 1000 << "|"
+                  << std::setw(18) << s.wakeSpread * 1000 << "|"
+                  << std::setw(17) << s.startSkewMax * 1000 << "|"
+                  << std::setw(12) << s.lateStarts << "\n";
+        worst.wakeDelayMax = std::max(worst.wakeDelayMax, s.wakeDelayMax);
+        worst.wakeSpread = std::max(worst.wakeSpread, s.wakeSpread);
+        worst.startSkewMax = std::max(worst.startSkewMax, s.startSkewMax);
+        worst.lateStarts += s.lateStarts;
+    }
+    // One greppable line per run so sweeps over cars= can be tabulated
+    std::cout << "Jitter: cars=" << options.numCars
+              << " cpus=" << cpus
+              << " oversubscription=" << std::setprecision(2) << oversubscription
+              << " wake_max_ms=" << std::setprecision(3) << worst.wakeDelayMax * 1000
+              << " wake_spread_ms=" << worst.wakeSpread * 1000
+              << " start_skew_ms=" << worst.startSkewMax * 1000
+              << " late_starts=" << worst.lateStarts << "\n";
+}
+
+void runCarProcess(int rank, const RaceOptions& options) {
     RaceResult result;
     result.carId = rank;
 
+    unsigned int seed = options.seed;
+    MPI_Bcast(&seed, 1, MPI_UNSIGNED, CarRace::REFEREE_RANK, MPI_COMM_WORLD);
+    long long clockOffset = syncClockWithReferee();
+    ProgressChannel channel(options.progressMode, options.numCars, rank);
+
     for (int stage = 0; stage < CarRace::NUM_STAGES; stage++) {
-        MPI_Barrier(MPI_COMM_WORLD);
-        
-        double startTime = MPI_Wtime();
-        int raceDelay = CarRace::generateRaceDelay(1000, 5000);
-        
-        int stepDelay = raceDelay / CarRace::TRACK_LENGTH;
+        // The referee publishes one start line instead of releasing a barrier
+        long long startNs;
+        MPI_Bcast(&startNs, 1, MPI_LONG_LONG, CarRace::REFEREE_RANK, MPI_COMM_WORLD);
+        long long wakeNs = monotonicNowNs();
+        long long localStartNs = startNs - clockOffset;
+        sleepUntilNs(localStartNs);
+        long long startedNs = monotonicNowNs();
+
+        int raceDelay = CarRace::generateRaceDelay(seed, result.carId, stage,
+                                                   options.minDelayMs, options.maxDelayMs);
+        long long stepNs = raceDelay * 1000000LL / CarRace::TRACK_LENGTH;
         
+        channel.resetUpdates();
         for (int progress = 0; progress <= CarRace::TRACK_LENGTH; progress++) {
-            MPI_Send(&progress, 1, MPI_INT, CarRace::REFEREE_RANK, 
-                    CarRace::PROGRESS_TAG, MPI_COMM_WORLD);
+            channel.publish(progress);
             
-            usleep(stepDelay * 1000);
+            // Steps are scheduled on the shared clock, so a late wakeup is caught up
+            sleepUntilNs(localStartNs + (progress + 1) * stepNs);
         }
+        channel.flush();
         
-        double endTime = MPI_Wtime();
-        result.stageTime = endTime - startTime;
+        long long finishNs = monotonicNowNs();
+        result.stageTime = (finishNs - localStartNs) / 1e9;
+        result.wakeNs = wakeNs + clockOffset;
+        result.startedNs = startedNs + clockOffset;
+        result.finishNs = finishNs + clockOffset;
+        result.updatesSent = channel.updatesSent();
         
         MPI_Barrier(MPI_COMM_WORLD);
         
@@ -56,51 +258,70 @@ void runCarProcess(int rank) {
     }
 }
 
-void runRefereeProcess() {
-    std::vector<RaceResult> results(CarRace::NUM_CARS);
-    std::vector<int> totalPoints(CarRace::NUM_CARS + 1, 0);
-    std::vector<int> positions(CarRace::NUM_CARS + 1, 0);
+void runRefereeProcess(const RaceOptions& options) {
+    const int numCars = options.numCars;
+    std::vector<RaceResult> results(numCars);
+    std::vector<int> totalPoints(numCars + 1, 0);
+    std::vector<int> positions(numCars + 1, 0);
+    std::vector<StageStats> stageStats(CarRace::NUM_STAGES);
+    TrackRenderer renderer(numCars);
+
+    unsigned int seed = options.seed;
+    MPI_Bcast(&seed, 1, MPI_UNSIGNED, CarRace::REFEREE_RANK, MPI_COMM_WORLD);
+    serveClockSync(numCars);
+    ProgressChannel channel(options.progressMode, numCars, CarRace::REFEREE_RANK);
 
     for (int stage = 0; stage < CarRace::NUM_STAGES; stage++) {
-        clearScreen();
-        std::cout << "\n=== Stage " << stage + 1 << " ===\n\n";
+        StageStats& stats = stageStats[stage];
+        if (!options.headless) {
+            renderer.beginStage(stage);
+        }
         
         std::fill(positions.begin(), positions.end(), 0);
-        MPI_Barrier(MPI_COMM_WORLD);
+        channel.resetPositions();
+        long long releaseNs = monotonicNowNs();
+        long long startNs = releaseNs + options.startLeadMs * 1000000LL;
+        MPI_Bcast(&startNs, 1, MPI_LONG_LONG, CarRace::REFEREE_RANK, MPI_COMM_WORLD);
         
         bool raceComplete = false;
         while (!raceComplete) {
             raceComplete = true;
             
-            for (int car = 1; car <= CarRace::NUM_CARS; car++) {
-                int flag;
-                MPI_Status status;
-                MPI_Iprobe(car, CarRace::PROGRESS_TAG, MPI_COMM_WORLD, &flag, &status);
-                
-                if (flag) {
-                    int progress;
-                    MPI_Recv(&progress, 1, MPI_INT, car, CarRace::PROGRESS_TAG, 
-                            MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                    positions[car] = progress;
-                }
-                
+            stats.progressMsgs += channel.poll(positions);
+            for (int car = 1; car <= numCars; car++) {
                 if (positions[car] < CarRace::TRACK_LENGTH) {
                     raceComplete = false;
                 }
             }
 
-            clearScreen();
-            std::cout << "\n=== Stage " << stage + 1 << " ===\n\n";
-            displayTrack(positions);
-            usleep(50000); // 50ms delay for visualization
+            if (!options.headless) {
+                renderer.update(positions);
+            }
+            stats.frames++;
+            if (!raceComplete) {
+                usleep(options.headless ? 1000 : 50000); // 50ms delay for visualization
+            }
         }
         
         MPI_Barrier(MPI_COMM_WORLD);
 
-        for (int i = 1; i <= CarRace::NUM_CARS; i++) {
+        long long firstWakeNs = LLONG_MAX, lastWakeNs = 0, lastStartedNs = 0;
+        for (int i = 1; i <= numCars; i++) {
             MPI_Recv(&results[i-1], sizeof(RaceResult), MPI_BYTE, 
                     i, CarRace::RESULT_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            stats.resultMsgs++;
+            stats.carUpdates += results[i-1].updatesSent;
+            firstWakeNs = std::min(firstWakeNs, results[i-1].wakeNs);
+            lastWakeNs = std::max(lastWakeNs, results[i-1].wakeNs);
+            lastStartedNs = std::max(lastStartedNs, results[i-1].startedNs);
+            if (results[i-1].wakeNs > startNs) {
+                stats.lateStarts++;
+            }
         }
+        stats.wallTime = (monotonicNowNs() - releaseNs) / 1e9;
+        stats.wakeDelayMax = std::max(0LL, lastWakeNs - releaseNs) / 1e9;
+        stats.wakeSpread = (lastWakeNs - firstWakeNs) / 1e9;
+        stats.startSkewMax = std::max(0LL, lastStartedNs - startNs) / 1e9;
 
         std::sort(results.begin(), results.end(),
                  [](const RaceResult& a, const RaceResult& b) {
@@ -111,9 +332,9 @@ void runRefereeProcess() {
         std::cout << "Position | Car ID | Time (s) | Points\n";
         std::cout << "---------|---------|----------|--------\n";
 
-        for (int i = 0; i < CarRace::NUM_CARS; i++) {
+        for (int i = 0; i < numCars; i++) {
             results[i].position = i + 1;
-            results[i].points = CarRace::POINTS[i];
+            results[i].points = CarRace::pointsFor(i + 1);
             totalPoints[results[i].carId] += results[i].points;
 
             std::cout << std::setw(9) << results[i].position << "|"
@@ -123,17 +344,24 @@ void runRefereeProcess() {
                      << std::setw(8) << results[i].points << "\n";
         }
         
-        std::cout << "\nPress Enter to continue...";
-        std::cin.get();
+        if (!options.headless) {
+            std::cout << "\nPress Enter to continue...";
+            std::cin.get();
+        }
     }
 
-    clearScreen();
+    if (options.headless) {
+        printStageSummary(options, stageStats);
+        printJitterReport(options, stageStats);
+    } else {
+        clearScreen();
+    }
     std::cout << "\nFinal Standings:\n";
     std::cout << "Car ID | Total Points\n";
     std::cout << "--------|-------------\n";
     
     std::vector<std::pair<int, int>> standings;
-    for (int i = 1; i <= CarRace::NUM_CARS; i++) {
+    for (int i = 1; i <= numCars; i++) {
         standings.push_back({i, totalPoints[i]});
     }
     
@@ -6,12 +6,35 @@
 #include <string>
 #include <random>
 #include <chrono>
+#include "progress_channel.h"
 
 struct RaceResult {
     int carId;
     double stageTime;
     int position;
     int points;
+    long long wakeNs;    // Referee clock: car returned from the start broadcast
+    long long startedNs; // Referee clock: car actually left the line
+    long long finishNs;  // Referee clock: car crossed the line
+    long updatesSent;    // Progress updates the car put on the wire
+};
+
+// Keeps the last drawn car positions and only rewrites rows that changed.
+// A frame is composed into one buffer and sent with a single write().
+class TrackRenderer {
+public:
+    explicit TrackRenderer(int numCars);
+
+    void beginStage(int stage);
+    void update(const std::vector<int>& positions);
+
+private:
+    int numCars;
+    std::vector<int> drawn;
+    std::string frame;
+
+    void appendCells(int car, int from, int pos);
+    void flush();
 };
 
 class CarRace {
@@ -21,30 +44,66 @@ public:
     static const int REFEREE_RANK = 0;
     static const int PROGRESS_TAG = 100;
     static const int RESULT_TAG = 200;
+    static const int CLOCK_TAG = 300;
     static const int TRACK_LENGTH = 40;
     
     static constexpr int POINTS[5] = {10, 8, 6, 4, 2};
+    static const int START_LEAD_MS = 20;  // Broadcast to start line by default
+    static const int CLOCK_SYNC_ROUNDS = 8;
 
     static bool isReferee(int rank) {
         return rank == REFEREE_RANK;
     }
 
     static bool isCarProcess(int rank) {
-        return rank > REFEREE_RANK && rank <= NUM_CARS;
+        return rank > REFEREE_RANK;
     }
 
     static int getCarId(int rank) {
         return rank;
     }
 
-    static int generateRaceDelay(int minMs, int maxMs) {
-        static std::mt19937 rng(std::chrono::steady_clock::now().time_since_epoch().count());
+    static int pointsFor(int position) {
+        return position <= 5 ? POINTS[position - 1] : 0;
+    }
+
+    // Every car draws from its own stream derived from the broadcast race
+    // seed, so a stage does not depend on when a rank was started.
+    static int generateRaceDelay(unsigned int seed, int carId, int stage, int minMs, int maxMs) {
+        std::seed_seq seq{seed, static_cast<unsigned int>(carId), static_cast<unsigned int>(stage)};
+        std::mt19937 rng(seq);
         std::uniform_int_distribution<int> dist(minMs, maxMs);
         return dist(rng);
     }
 };
 
-void runRefereeProcess();
-void runCarProcess(int rank);
+struct RaceOptions {
+    bool headless = false; // No rendering and no pauses between stages
+    int minDelayMs = 1000;
+    int maxDelayMs = 5000;
+    int numCars = CarRace::NUM_CARS; // Every rank but the referee drives a car
+    int startLeadMs = CarRace::START_LEAD_MS;
+    unsigned int seed = std::random_device{}(); // Replaced by the referee's seed
+    ProgressMode progressMode = ProgressMode::Send;
+};
+
+struct StageStats {
+    double wallTime = 0;   // Start broadcast to last result received
+    long carUpdates = 0;   // Progress updates sent by all cars
+    long progressMsgs = 0; // Updates received (or window reads) by the referee
+    long resultMsgs = 0;
+    long frames = 0;       // Referee loop iterations
+    double wakeDelayMax = 0;  // Latest wakeup from the start broadcast
+    double wakeSpread = 0;    // Latest minus earliest wakeup
+    double startSkewMax = 0;  // Latest actual start after the published start
+    int lateStarts = 0;       // Cars that woke after the published start
+};
+
+bool parseRaceOptions(int argc, char** argv, int first, RaceOptions& options);
+void printStageSummary(const RaceOptions& options, const std::vector<StageStats>& stats);
+void printJitterReport(const RaceOptions& options, const std::vector<StageStats>& stats);
+
+void runRefereeProcess(const RaceOptions& options);
+void runCarProcess(int rank, const RaceOptions& options);
 
 #endif // CAR_RACE_H 
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "checkpoint.h"
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+static const char HEADER_MAGIC[4] = {'C', 'K', 'P', 'T'};
+static const char MANIFEST_MAGIC[4] = {'C', 'K', 'P', 'M'};
+
+CheckpointHeader checkpoint_header() {
+    CheckpointHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, HEADER_MAGIC, sizeof(HEADER_MAGIC));
+    header.version = 1;
+    return header;
+}
+
+static std::string slot_path(const std::string& dir, int rank, int slot) {
+    return dir + "/gemm." + std::to_string(rank) + "." + std::to_string(slot);
+}
+
+static bool write_all(int fd, const void* data, size_t bytes) {
+    const char* p = static_cast<const char*>(data);
+    while (bytes > 0) {
+        ssize_t written = ::write(fd, p, bytes);
+        if (written < 0) {
+            return false;
+        }
+        p += written;
+        bytes -= written;
+    }
+    return true;
+}
+
+static bool read_all(int fd, void* data, size_t bytes) {
+    char* p = static_cast<char*>(data);
+    while (bytes > 0) {
+        ssize_t got = ::read(fd, p, bytes);
+        if (got <= 0) {
+            return false;
+        }
+        p += got;
+        bytes -= got;
+    }
+    return true;
+}
+
+// Written under a temporary name, synced and renamed into place, so path
+// always holds either the old contents or the complete new ones
+static bool write_file(const std::string& path, const void* head, size_t head_bytes,
+                       const void* body, size_t body_bytes) {
+    std::string temporary = path + ".tmp";
+    int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = write_all(fd, head, head_bytes) && write_all(fd, body, body_bytes) && ::fsync(fd) == 0;
+    ok = ::close(fd) == 0 && ok;
+    return ok && std::rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+CheckpointWriter::CheckpointWriter(const std::string& dir, int rank) : dir(dir), rank(rank) {
+    // Started last, once the members it uses exist
+    thread = std::thread(&CheckpointWriter::run, this);
+}
+
+CheckpointWriter::~CheckpointWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    thread.join();
+}
+
+bool CheckpointWriter::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return !busy; });
+    bool ok = !failed;
+    failed = false;
+    return ok;
+}
+
+void CheckpointWriter::submit(const CheckpointHeader& header, const void* data, int slot) {
+    // The writer is idle after wait(), so the snapshot is ours to fill
+    snapshot.resize(header.bytes);
+    std::memcpy(snapshot.data(), data, header.bytes);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = header;
+        pending_slot = slot;
+        busy = true;
+    }
+    wake.notify_one();
+}
+
+void CheckpointWriter::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return busy || stopping; });
+        if (!busy) {
+            return;
+        }
+        lock.unlock();
+        bool ok = write_file(slot_path(dir, rank, pending_slot), &pending, sizeof(pending),
+                             snapshot.data(), snapshot.size());
+        lock.lock();
+        failed = !ok;
+        busy = false;
+        done.notify_all();
+    }
+}
+
+bool write_checkpoint_manifest(const std::string& dir, const CheckpointManifest& manifest) {
+    CheckpointManifest copy = manifest;
+    std::memcpy(copy.magic, MANIFEST_MAGIC, sizeof(MANIFEST_MAGIC));
+    return write_file(dir + "/gemm.complete", &copy, sizeof(copy), nullptr, 0);
+}
+
+bool read_checkpoint_manifest(const std::string& dir, CheckpointManifest& manifest) {
+    int fd = ::open((dir + "/gemm.complete").c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = read_all(fd, &manifest, sizeof(manifest));
+    ::close(fd);
+    return ok && std::memcmp(manifest.magic, MANIFEST_MAGIC, sizeof(MANIFEST_MAGIC)) == 0;
+}
+
+void remove_checkpoints(const std::string& dir, int rank) {
+    for (int slot = 0; slot < 2; slot++) {
+        ::unlink(slot_path(dir, rank, slot).c_str());
+    }
+    if (rank == 0) {
+        ::unlink((dir + "/gemm.complete").c_str());
+    }
+}
+
+bool read_checkpoint(const std::string& dir, int rank, int slot, CheckpointHeader& expected, void* data) {
+    int fd = ::open(slot_path(dir, rank, slot).c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    CheckpointHeader header;
+    bool ok = read_all(fd, &header, sizeof(header));
+    if (ok) {
+        // Everything but the position must match the job being resumed
+        int64_t next_k = header.next_k;
+        header.next_k = expected.next_k;
+        ok = std::memcmp(&header, &expected, sizeof(header)) == 0 && read_all(fd, data, header.bytes);
+        expected.next_k = next_k;
+    }
+    ::close(fd);
+    return ok;
+}
@@ -0,0 +1,85 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// What one rank saves: its place in the job and the shape of its tile, so
+// a restart can tell whether the file belongs to the same job and layout.
+struct CheckpointHeader {
+    char magic[4];       // "CKPT"
+    uint32_t version;    // 1
+    int32_t rank;
+    int32_t size;
+    int32_t grid[2];
+    int64_t m, k, n;
+    uint32_t elem_size;
+    int32_t panel;
+    int64_t next_k;      // First K column not yet in the saved tile
+    uint64_t bytes;      // Tile data after the header
+};
+
+// Written by rank 0 once every rank's file of a checkpoint is on disk. No
+// rank writes to the slot it names, so that set stays complete.
+struct CheckpointManifest {
+    char magic[4];       // "CKPM"
+    int32_t size;
+    int32_t slot;
+    int64_t next_k;
+};
+
+// Initializes magic and version; the caller fills in the rest
+CheckpointHeader checkpoint_header();
+
+// Writes one rank's checkpoints on a thread of its own, so the caller only
+// pays for copying its tile into the snapshot buffer. Files are
+// dir/gemm.<rank>.<slot> in two slots; the caller picks the slot, and must
+// not pick the one the manifest names. No MPI calls are made here.
+class CheckpointWriter {
+public:
+    CheckpointWriter(const std::string& dir, int rank);
+    ~CheckpointWriter();
+
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    // Blocks until the last submitted snapshot is on disk; false if it failed
+    bool wait();
+    // Copies the tile and starts writing it to slot. Call wait() first.
+    void submit(const CheckpointHeader& header, const void* data, int slot);
+
+private:
+    std::string dir;
+    int rank;
+    std::vector<char> snapshot;
+    CheckpointHeader pending{};
+    int pending_slot = 0;
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    bool busy = false;
+    bool failed = false;
+    bool stopping = false;
+
+    void run();
+};
+
+// Atomic replacement of dir/gemm.complete; false if it could not be written
+bool write_checkpoint_manifest(const std::string& dir, const CheckpointManifest& manifest);
+bool read_checkpoint_manifest(const std::string& dir, CheckpointManifest& manifest);
+
+// Removes this rank's files of both slots, and the manifest on rank 0, so a
+// new job cannot be resumed from an earlier one's checkpoints
+void remove_checkpoints(const std::string& dir, int rank);
+
+// Reads this rank's file of slot into data if its header matches expected
+// in everything but next_k, which is returned through expected
+bool read_checkpoint(const std::string& dir, int rank, int slot, CheckpointHeader& expected, void* data);
+
+#endif // CHECKPOINT_H
@@ -0,0 +1,1136 @@
+#include "dist_gemm.h"
+#include "gemm_kernel.h"
+#include "thread_pool.h"
+#include "bench.h"
+#include "topology.h"
+#include "matrix_io.h"
+#include "checkpoint.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+
+static const unsigned SEED_A = 1;
+static const unsigned SEED_B = 2;
+static const int VERIFY_SAMPLES = 16;
+
+bool parse_gemm_options(int argc, char** argv, int first, GemmOptions& options) {
+    bool verify_given = false;
+    for (int i = first; i < argc; i++) {
+        std::string arg(argv[i]);
+        size_t eq = arg.find('=');
+        if (eq == std::string::npos) {
+            return false;
+        }
+        std::string key = arg.substr(0, eq);
+        std::string value = arg.substr(eq + 1);
+
+        if (key == "size") {
+            options.m = options.k = options.n = std::atoi(value.c_str());
+        } else if (key == "m") {
+            options.m = std::atoi(value.c_str());
+        } else if (key == "k") {
+            options.k = std::atoi(value.c_str());
+        } else if (key == "n") {
+            options.n = std::atoi(value.c_str());
+        } else if (key == "layers") {
+            options.layers = std::atoi(value.c_str());
+        } else if (key == "count") {
+            options.count = std::atoi(value.c_str());
+        } else if (key == "grid") {
+            if (std::sscanf(value.c_str(), "%dx%d", &options.grid_rows, &options.grid_cols) != 2) {
+                return false;
+            }
+        } else if (key == "panel") {
+            options.panel = std::atoi(value.c_str());
+        } else if (key == "dtype") {
+            options.dtype = value;
+        } else if (key == "warmup") {
+            options.warmup = std::atoi(value.c_str());
+        } else if (key == "reps") {
+            options.reps = std::atoi(value.c_str());
+        } else if (key == "threads") {
+            options.threads = std::atoi(value.c_str());
+        } else if (key == "pin") {
+            options.pin = std::atoi(value.c_str()) != 0;
+        } else if (key == "overlap") {
+            options.overlap = std::atoi(value.c_str()) != 0;
+        } else if (key == "verify") {
+            options.verify = std::atoi(value.c_str()) != 0;
+            verify_given = true;
+        } else if (key == "a") {
+            options.a_file = value;
+        } else if (key == "b") {
+            options.b_file = value;
+        } else if (key == "c") {
+            options.c_file = value;
+        } else if (key == "checkpoint") {
+            options.checkpoint = value;
+        } else if (key == "interval") {
+            options.interval = std::atoi(value.c_str());
+        } else if (key == "restart") {
+            options.restart = std::atoi(value.c_str()) != 0;
+        } else if (key == "fail") {
+            options.fail = std::atoi(value.c_str());
+        } else {
+            return false;
+        }
+    }
+    if (!options.a_file.empty() && !verify_given) {
+        options.verify = false; // Other data would not match the generator
+    }
+    return options.m > 0 && options.k > 0 && options.n > 0 &&
+           options.a_file.empty() == options.b_file.empty() &&
+           options.interval > 0 && options.fail >= 0 && (!options.restart || !options.checkpoint.empty()) &&
+           options.panel > 0 && options.layers > 0 && options.count > 0 && options.warmup >= 0 && options.reps > 0 && options.threads > 0 &&
+           options.grid_rows >= 0 && options.grid_cols >= 0 &&
+           (options.dtype == "int8" || options.dtype == "int16" || options.dtype == "int32" ||
+            options.dtype == "float" || options.dtype == "double");
+}
+
+BlockRange block_range(int n, int parts, int index) {
+    int base = n / parts;
+    int extra = n % parts;
+    return {index * base + std::min(index, extra), base + (index < extra ? 1 : 0)};
+}
+
+int block_owner(int n, int parts, int item) {
+    for (int part = 0; part < parts; part++) {
+        BlockRange range = block_range(n, parts, part);
+        if (item < range.start + range.size) {
+            return part;
+        }
+    }
+    return parts - 1;
+}
+
+double matrix_value(unsigned seed, long long row, long long col) {
+    // splitmix64 of the coordinates, mapped to 1..10 like the fixed-size modes
+    uint64_t x = seed * 0x9E3779B97F4A7C15ULL + static_cast<uint64_t>(row) * 0x100000001B3ULL +
+                 static_cast<uint64_t>(col);
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return static_cast<double>(1 + x % 10);
+}
+
+template<typename T>
+void fill_block(std::vector<T>& block, unsigned seed, BlockRange rows, BlockRange cols) {
+    block.resize(static_cast<size_t>(rows.size) * cols.size);
+    for (int i = 0; i < rows.size; i++) {
+        for (int j = 0; j < cols.size; j++) {
+            block[static_cast<size_t>(i) * cols.size + j] =
+                static_cast<T>(matrix_value(seed, rows.start + i, cols.start + j));
+        }
+    }
+}
+
+template<typename T>
+long verify_block(const T* C, int ldc, BlockRange rows, BlockRange cols, int k, int samples) {
+    if (rows.size == 0 || cols.size == 0) {
+        return 0;
+    }
+    long errors = 0;
+    for (int s = 0; s < samples; s++) {
+        // Spread the samples over the tile, always including both corners
+        int i = samples > 1 ? static_cast<int>(static_cast<long long>(s) * (rows.size - 1) / (samples - 1)) : 0;
+        int j = samples > 1 ? static_cast<int>(static_cast<long long>(s * 7 % samples) * (cols.size - 1) / (samples - 1)) : 0;
+        double expected = 0;
+        for (int p = 0; p < k; p++) {
+            expected += matrix_value(SEED_A, rows.start + i, p) * matrix_value(SEED_B, p, cols.start + j);
+        }
+        // Operands are small integers, so every element type must be exact
+        if (static_cast<double>(C[static_cast<size_t>(i) * ldc + j]) != expected) {
+            errors++;
+        }
+    }
+    return errors;
+}
+
+template void fill_block<int32_t>(std::vector<int32_t>&, unsigned, BlockRange, BlockRange);
+template void fill_block<float>(std::vector<float>&, unsigned, BlockRange, BlockRange);
+template void fill_block<double>(std::vector<double>&, unsigned, BlockRange, BlockRange);
+template long verify_block<int32_t>(const int32_t*, int, BlockRange, BlockRange, int, int);
+template long verify_block<float>(const float*, int, BlockRange, BlockRange, int, int);
+template long verify_block<double>(const double*, int, BlockRange, BlockRange, int, int);
+
+static std::string gemm_size_label(const GemmOptions& options) {
+    return std::to_string(options.m) + "x" + std::to_string(options.k) + "x" + std::to_string(options.n);
+}
+
+// One pool per rank. Ranks sharing a node take consecutive runs of CPUs,
+// so pinned pools of different ranks do not land on the same cores.
+static int node_first_cpu(const GemmOptions& options) {
+    return node_topology().node_rank * options.threads;
+}
+
+// C[m x n] += A[m x k] * B[k x n] with the rows cut into strips that the
+// pool works through. The kernel keeps its packing buffers per thread, so
+// strips can run concurrently. Worker 0 is the MPI thread and calls poll
+// after each of its strips to drive outstanding nonblocking requests.
+template<typename T, typename Acc>
+static void pooled_gemm(ThreadPool& pool, int m, int n, int k, const T* A, int lda,
+                        const T* B, int ldb, Acc* C, int ldc, const std::function<void()>& poll) {
+    const int max_strip = 64;
+    int strip = std::min(max_strip, std::max(1, (m + pool.size() - 1) / pool.size()));
+    int strips = (m + strip - 1) / strip;
+    pool.parallel_for(strips, [&](int s, int worker) {
+        int i0 = s * strip;
+        int rows = std::min(strip, m - i0);
+        local_gemm(rows, n, k, A + static_cast<size_t>(i0) * lda, lda, B, ldb,
+                   C + static_cast<size_t>(i0) * ldc, ldc);
+        if (worker == 0 && poll) {
+            poll();
+        }
+    });
+}
+
+// SUMMA on a Pr x Pc grid. Rank (r, c) owns the A[r][c], B[r][c] and
+// C[r][c] blocks; K is cut over the grid columns for A and over the grid
+// rows for B. Every step broadcasts one K panel of A along the process row
+// and the matching panel of B down the process column, then updates C.
+//
+// With a= and b= every rank reads just its A and B tiles from the matrix
+// files, and with c= writes its C tile, all through collective MPI-IO.
+//
+// With checkpoint= every interval panel steps all ranks save their C tile
+// and the next K column. The steps run in lockstep, so the checkpoints are
+// coordinated without extra messages: each rank copies its tile to a
+// CheckpointWriter and goes on computing. At the next checkpoint an
+// MPI_Allreduce confirms every rank finished the previous write, and only
+// then does rank 0 record it as complete.
+template<typename T>
+static void summa_gemm(int rank, int size, const GemmOptions& options,
+                       const MatrixHeader& a_header, const MatrixHeader& b_header) {
+    int dims[2] = {options.grid_rows, options.grid_cols};
+    if (dims[0] * dims[1] != 0 && dims[0] * dims[1] != size) {
+        if (rank == 0) {
+            std::cerr << "Grid " << dims[0] << "x" << dims[1] << " does not match " << size << " processes\n";
+        }
+        return;
+    }
+    MPI_Dims_create(size, 2, dims);
+
+    int periods[2] = {0, 0};
+    MPI_Comm grid_comm, row_comm, col_comm;
+    // Grid rows are consecutive in the node-major order, so the A panel
+    // broadcasts along a row stay on one node when a node holds whole rows
+    cart_create_local(2, dims, periods, &grid_comm);
+    int grid_rank, coords[2];
+    MPI_Comm_rank(grid_comm, &grid_rank);
+    MPI_Cart_coords(grid_comm, grid_rank, 2, coords);
+
+    int keep_cols[2] = {0, 1};
+    int keep_rows[2] = {1, 0};
+    MPI_Cart_sub(grid_comm, keep_cols, &row_comm); // Same grid row, ranked by column
+    MPI_Cart_sub(grid_comm, keep_rows, &col_comm); // Same grid column, ranked by row
+
+    typedef typename Accumulator<T>::type Acc;
+    const int M = options.m, K = options.k, N = options.n;
+    BlockRange my_rows = block_range(M, dims[0], coords[0]);
+    BlockRange my_cols = block_range(N, dims[1], coords[1]);
+    BlockRange my_a_k = block_range(K, dims[1], coords[1]);
+    BlockRange my_b_k = block_range(K, dims[0], coords[0]);
+
+    std::vector<T> A, B;
+    double read_time = 0;
+    if (options.a_file.empty()) {
+        fill_block(A, SEED_A, my_rows, my_a_k);
+        fill_block(B, SEED_B, my_b_k, my_cols);
+    } else {
+        A.resize(static_cast<size_t>(my_rows.size) * my_a_k.size);
+        B.resize(static_cast<size_t>(my_b_k.size) * my_cols.size);
+        double start = MPI_Wtime();
+        bool loaded = read_matrix_tile(grid_comm, options.a_file, a_header, mpi_type<T>(),
+                                       {my_rows.start, my_a_k.start, my_rows.size, my_a_k.size}, A.data()) &&
+                      read_matrix_tile(grid_comm, options.b_file, b_header, mpi_type<T>(),
+                                       {my_b_k.start, my_cols.start, my_b_k.size, my_cols.size}, B.data());
+        read_time = MPI_Wtime() - start;
+        MPI_Allreduce(MPI_IN_PLACE, &read_time, 1, MPI_DOUBLE, MPI_MAX, grid_comm);
+        if (!loaded) {
+            MPI_Comm_free(&row_comm);
+            MPI_Comm_free(&col_comm);
+            MPI_Comm_free(&grid_comm);
+            return;
+        }
+    }
+
+    ThreadPool pool(options.threads, options.pin, node_first_cpu(options));
+
+    std::vector<Acc> C(static_cast<size_t>(my_rows.size) * my_cols.size);
+    std::vector<T> a_panel(static_cast<size_t>(my_rows.size) * options.panel);
+    std::vector<T> b_panel(static_cast<size_t>(options.panel) * my_cols.size);
+
+    std::unique_ptr<CheckpointWriter> writer;
+    CheckpointHeader header = checkpoint_header();
+    header.rank = grid_rank;
+    header.size = size;
+    header.grid[0] = dims[0];
+    header.grid[1] = dims[1];
+    header.m = M;
+    header.k = K;
+    header.n = N;
+    header.elem_size = sizeof(Acc);
+    header.panel = options.panel;
+    header.bytes = C.size() * sizeof(Acc);
+    int recorded_slot = -1;     // Slot named by the manifest; never written to
+    int saved_slot = 0;
+    bool in_flight = false;     // The last one may not be on every rank's disk yet
+    long long saved_k = 0;
+    double stalled = 0;         // Main thread time spent on checkpoints in timed runs
+    double waited = 0;          // The part of it spent waiting for the previous write
+    int taken = 0;
+    auto take_checkpoint = [&](int next_k, bool timed) {
+        double start = MPI_Wtime();
+        int written = writer->wait() ? 1 : 0;
+        MPI_Allreduce(MPI_IN_PLACE, &written, 1, MPI_INT, MPI_LAND, grid_comm);
+        double wait_end = MPI_Wtime();
+        if (in_flight) {
+            if (grid_rank == 0) {
+                if (!written) {
+                    std::cerr << "Checkpoint at K column " << saved_k << " failed on some rank\n";
+                } else if (!write_checkpoint_manifest(options.checkpoint, {{}, size, saved_slot, saved_k})) {
+                    std::cerr << options.checkpoint << ": cannot record the checkpoint at K column " << saved_k
+                              << "\n";
+                } else {
+                    recorded_slot = saved_slot;
+                }
+            }
+            // Nobody writes to the slot the old manifest named before the new one is in place
+            MPI_Bcast(&recorded_slot, 1, MPI_INT, 0, grid_comm);
+        }
+        in_flight = next_k >= 0;
+        if (in_flight) {
+            header.next_k = saved_k = next_k;
+            saved_slot = recorded_slot == 0 ? 1 : 0;
+            writer->submit(header, C.data(), saved_slot);
+        }
+        if (timed) {
+            stalled += MPI_Wtime() - start;
+            waited += wait_end - start;
+            taken += in_flight ? 1 : 0;
+        }
+    };
+
+    std::vector<Acc> resumed;
+    int resume_k = 0;
+    if (!options.checkpoint.empty()) {
+        writer.reset(new CheckpointWriter(options.checkpoint, grid_rank));
+        if (!options.restart) {
+            remove_checkpoints(options.checkpoint, grid_rank);
+        }
+    }
+    if (options.restart) {
+        // A slot is complete when every rank's file of it reads back with
+        // the same K column. The manifest names one such slot, but the job
+        // may have died after the other one was written and before it was
+        // recorded, so both are checked and the later one wins.
+        std::vector<Acc> slot_data[2];
+        long long slot_k[2];
+        for (int slot = 0; slot < 2; slot++) {
+            CheckpointHeader expected = header;
+            slot_data[slot].resize(C.size());
+            long long k = read_checkpoint(options.checkpoint, grid_rank, slot, expected, slot_data[slot].data())
+                              ? expected.next_k : -1;
+            long long range[2] = {k, -k};
+            MPI_Allreduce(MPI_IN_PLACE, range, 2, MPI_LONG_LONG, MPI_MIN, grid_comm);
+            slot_k[slot] = range[0] == -range[1] && range[0] > 0 ? range[0] : -1;
+        }
+        int slot = slot_k[1] > slot_k[0] ? 1 : 0;
+        bool found = slot_k[slot] > 0;
+        if (found) {
+            resume_k = static_cast<int>(slot_k[slot]);
+            resumed.swap(slot_data[slot]);
+            recorded_slot = slot;
+            // The manifest has to name the restored set before any rank
+            // writes its next checkpoint to the other slot
+            CheckpointManifest manifest{};
+            if (grid_rank == 0 &&
+                (!read_checkpoint_manifest(options.checkpoint, manifest) || manifest.slot != slot ||
+                 manifest.next_k != resume_k) &&
+                !write_checkpoint_manifest(options.checkpoint, {{}, size, slot, resume_k})) {
+                std::cerr << options.checkpoint << ": cannot record the checkpoint at K column " << resume_k << "\n";
+            }
+            MPI_Barrier(grid_comm);
+        }
+        if (grid_rank == 0) {
+            if (found) {
+                std::cout << "Restart: resuming from the checkpoint at K column " << resume_k << " of " << K
+                          << "; the first run only multiplies the rest\n";
+            } else {
+                std::cout << "Restart: no complete checkpoint of this job in " << options.checkpoint
+                          << ", starting over\n";
+            }
+        }
+    }
+
+    BenchTimer timer(grid_comm, options.warmup, options.reps);
+    for (int run = 0; run < timer.runs(); run++) {
+        bool resuming = run == 0 && !resumed.empty();
+        if (resuming) {
+            std::copy(resumed.begin(), resumed.end(), C.begin());
+        } else {
+            std::fill(C.begin(), C.end(), Acc(0));
+        }
+        timer.start();
+
+        int steps = 0;
+        for (int k0 = resuming ? resume_k : 0; k0 < K; ) {
+            // A panel must not cross an A column block, nor B's row block
+            int a_owner = block_owner(K, dims[1], k0);
+            int b_owner = block_owner(K, dims[0], k0);
+            BlockRange a_k = block_range(K, dims[1], a_owner);
+            BlockRange b_k = block_range(K, dims[0], b_owner);
+            int width = std::min({options.panel, a_k.start + a_k.size - k0, b_k.start + b_k.size - k0});
+
+            if (coords[1] == a_owner) {
+                for (int i = 0; i < my_rows.size; i++) {
+                    std::copy_n(&A[static_cast<size_t>(i) * my_a_k.size + (k0 - my_a_k.start)], width,
+                                &a_panel[static_cast<size_t>(i) * width]);
+                }
+            }
+            if (coords[0] == b_owner) {
+                std::copy_n(&B[static_cast<size_t>(k0 - my_b_k.start) * my_cols.size],
+                            static_cast<size_t>(width) * my_cols.size, b_panel.begin());
+            }
+            MPI_Bcast(a_panel.data(), my_rows.size * width, mpi_type<T>(), a_owner, row_comm);
+            MPI_Bcast(b_panel.data(), width * my_cols.size, mpi_type<T>(), b_owner, col_comm);
+
+            pooled_gemm<T>(pool, my_rows.size, my_cols.size, width, a_panel.data(), width,
+                           b_panel.data(), my_cols.size, C.data(), my_cols.size, nullptr);
+            k0 += width;
+            steps++;
+
+            if (writer && steps % options.interval == 0 && k0 < K) {
+                take_checkpoint(k0, run >= options.warmup);
+            }
+            if (run == 0 && steps == options.fail) {
+                if (grid_rank == 0) {
+                    std::cerr << "Aborting the job after panel step " << steps << " (K column " << k0 << ")\n";
+                }
+                MPI_Abort(grid_comm, 3);
+            }
+        }
+
+        timer.stop();
+    }
+    const BenchStats& stats = timer.stats();
+    if (writer) {
+        take_checkpoint(-1, false); // Record the last one before the writer goes away
+    }
+    double stall_times[2] = {stalled, waited};
+    MPI_Allreduce(MPI_IN_PLACE, stall_times, 2, MPI_DOUBLE, MPI_MAX, grid_comm);
+
+    long errors = options.verify ? verify_block(C.data(), my_cols.size, my_rows, my_cols, K, VERIFY_SAMPLES) : 0;
+    MPI_Allreduce(MPI_IN_PLACE, &errors, 1, MPI_LONG, MPI_SUM, grid_comm);
+
+    double write_time = 0;
+    bool written = false;
+    if (!options.c_file.empty()) {
+        double start = MPI_Wtime();
+        written = write_matrix_tile(grid_comm, options.c_file, M, N, mpi_type<Acc>(),
+                                    {my_rows.start, my_cols.start, my_rows.size, my_cols.size}, C.data());
+        write_time = MPI_Wtime() - start;
+        MPI_Allreduce(MPI_IN_PLACE, &write_time, 1, MPI_DOUBLE, MPI_MAX, grid_comm);
+    }
+
+    if (grid_rank == 0) {
+        double gflops = 2.0 * M * N * K / stats.best / 1e9;
+        std::cout << "SUMMA C[" << M << "x" << N << "] = A[" << M << "x" << K << "] * B[" << K << "x" << N
+                  << "] on a " << dims[0] << "x" << dims[1] << " grid x " << options.threads
+                  << (options.pin ? " pinned" : "") << " threads, panel " << options.panel
+                  << ", " << options.dtype << ", " << kernel_isa_name(kernel_isa()) << " kernel\n";
+        std::cout << std::fixed << std::setprecision(6)
+                  << "Time: best " << stats.best << " s, mean " << stats.mean << " s over "
+                  << options.reps << " runs, " << std::setprecision(2) << gflops << " GFLOP/s\n";
+        // Every A panel reaches Pc - 1 other ranks of its row, every B panel Pr - 1
+        double moved = (static_cast<double>(M) * K * (dims[1] - 1) +
+                        static_cast<double>(K) * N * (dims[0] - 1)) * sizeof(T);
+        std::cout << std::setprecision(1) << "Traffic: " << moved / (1 << 20) << " MiB between ranks\n";
+        if (writer) {
+            std::cout << "Checkpoint: every " << options.interval << " panel steps, " << std::setprecision(1)
+                      << static_cast<double>(taken) / options.reps << " per run of "
+                      << header.bytes / double(1 << 20) << " MiB per rank; computation stalled "
+                      << std::setprecision(6) << stall_times[0] / options.reps << " s per run ("
+                      << std::setprecision(2) << 100.0 * stall_times[0] / options.reps / stats.mean << "%), "
+                      << std::setprecision(6) << stall_times[1] / options.reps
+                      << " s of it waiting for the previous write\n";
+        }
+        if (!options.a_file.empty()) {
+            double bytes = (static_cast<double>(M) * K + static_cast<double>(K) * N) * sizeof(T);
+            std::cout << std::setprecision(3) << "Read: A and B, " << bytes / (1 << 20) << " MiB in " << read_time
+                      << " s, " << std::setprecision(1) << bytes / (1 << 20) / read_time << " MiB/s\n";
+        }
+        if (written) {
+            double bytes = static_cast<double>(M) * N * sizeof(Acc);
+            std::cout << std::setprecision(3) << "Write: C to " << options.c_file << ", " << bytes / (1 << 20)
+                      << " MiB in " << write_time << " s, " << std::setprecision(1)
+                      << bytes / (1 << 20) / write_time << " MiB/s\n";
+        }
+        if (options.verify) {
+            std::cout << "Verification: " << (errors == 0 ? "passed" : "FAILED")
+                      << " (" << errors << " wrong sampled entries)\n";
+        }
+    }
+
+    bench_report(grid_comm, "matrix_mult", "gemm", gemm_size_label(options), stats);
+
+    MPI_Comm_free(&row_comm);
+    MPI_Comm_free(&col_comm);
+    MPI_Comm_free(&grid_comm);
+}
+
+void multiply_matrices_summa(int rank, int size, const GemmOptions& options) {
+    // Shape and element type come from the files when there are any
+    GemmOptions run = options;
+    MatrixHeader a_header{}, b_header{};
+    if (!options.a_file.empty()) {
+        if (!read_matrix_header(MPI_COMM_WORLD, options.a_file, a_header) ||
+            !read_matrix_header(MPI_COMM_WORLD, options.b_file, b_header)) {
+            return;
+        }
+        if (a_header.cols != b_header.rows || a_header.dtype != b_header.dtype) {
+            if (rank == 0) {
+                std::cerr << "A is " << a_header.rows << "x" << a_header.cols << " " << matrix_type_name(a_header.dtype)
+                          << ", B is " << b_header.rows << "x" << b_header.cols << " "
+                          << matrix_type_name(b_header.dtype) << "; they cannot be multiplied\n";
+            }
+            return;
+        }
+        run.m = static_cast<int>(a_header.rows);
+        run.k = static_cast<int>(a_header.cols);
+        run.n = static_cast<int>(b_header.cols);
+        run.dtype = matrix_type_name(a_header.dtype);
+    }
+
+    if (run.dtype == "int8") {
+        summa_gemm<int8_t>(rank, size, run, a_header, b_header);
+    } else if (run.dtype == "int16") {
+        summa_gemm<int16_t>(rank, size, run, a_header, b_header);
+    } else if (run.dtype == "int32") {
+        summa_gemm<int32_t>(rank, size, run, a_header, b_header);
+    } else if (run.dtype == "float") {
+        summa_gemm<float>(rank, size, run, a_header, b_header);
+    } else {
+        summa_gemm<double>(rank, size, run, a_header, b_header);
+    }
+}
+
+// 2.5D SUMMA on a c x Pr x Pc grid: c layers, each a Pr x Pc SUMMA grid.
+// Layer 0 owns the A and B blocks like plain SUMMA. Every run replicates
+// them to the other layers down the depth fibers, each layer runs the
+// SUMMA steps for its 1/c share of K, and the partial C blocks are summed
+// back onto layer 0. A layer is a consecutive run of the node-major order,
+// so the panel broadcasts stay within nodes where they can and only the
+// replication and the reduction cross between layers.
+template<typename T>
+static void summa_25d_gemm(int rank, int size, const GemmOptions& options) {
+    const int layers = options.layers;
+    if (size % layers != 0) {
+        if (rank == 0) {
+            std::cerr << layers << " layers do not divide " << size << " processes\n";
+        }
+        return;
+    }
+    int plane[2] = {options.grid_rows, options.grid_cols};
+    if (plane[0] * plane[1] != 0 && plane[0] * plane[1] != size / layers) {
+        if (rank == 0) {
+            std::cerr << "Grid " << plane[0] << "x" << plane[1] << " x " << layers << " layers does not match "
+                      << size << " processes\n";
+        }
+        return;
+    }
+    MPI_Dims_create(size / layers, 2, plane);
+
+    int dims[3] = {layers, plane[0], plane[1]};
+    int periods[3] = {0, 0, 0};
+    MPI_Comm grid_comm, row_comm, col_comm, fiber_comm;
+    cart_create_local(3, dims, periods, &grid_comm);
+    int grid_rank, coords[3];
+    MPI_Comm_rank(grid_comm, &grid_rank);
+    MPI_Cart_coords(grid_comm, grid_rank, 3, coords);
+    const int layer = coords[0];
+
+    int keep_cols[3] = {0, 0, 1};
+    int keep_rows[3] = {0, 1, 0};
+    int keep_depth[3] = {1, 0, 0};
+    MPI_Cart_sub(grid_comm, keep_cols, &row_comm);    // Same layer and grid row, ranked by column
+    MPI_Cart_sub(grid_comm, keep_rows, &col_comm);    // Same layer and grid column, ranked by row
+    MPI_Cart_sub(grid_comm, keep_depth, &fiber_comm); // Same block in every layer, ranked by layer
+
+    typedef typename Accumulator<T>::type Acc;
+    const int M = options.m, K = options.k, N = options.n;
+    BlockRange my_rows = block_range(M, dims[1], coords[1]);
+    BlockRange my_cols = block_range(N, dims[2], coords[2]);
+    BlockRange my_a_k = block_range(K, dims[2], coords[2]);
+    BlockRange my_b_k = block_range(K, dims[1], coords[1]);
+    BlockRange layer_k = block_range(K, layers, layer);
+
+    // Every layer holds whole A and B blocks: c times the memory of SUMMA
+    std::vector<T> A, B;
+    if (layer == 0) {
+        fill_block(A, SEED_A, my_rows, my_a_k);
+        fill_block(B, SEED_B, my_b_k, my_cols);
+    } else {
+        A.resize(static_cast<size_t>(my_rows.size) * my_a_k.size);
+        B.resize(static_cast<size_t>(my_b_k.size) * my_cols.size);
+    }
+
+    ThreadPool pool(options.threads, options.pin, node_first_cpu(options));
+
+    std::vector<Acc> C(static_cast<size_t>(my_rows.size) * my_cols.size);
+    std::vector<T> a_panel(static_cast<size_t>(my_rows.size) * options.panel);
+    std::vector<T> b_panel(static_cast<size_t>(options.panel) * my_cols.size);
+
+    BenchTimer timer(grid_comm, options.warmup, options.reps);
+    for (int run = 0; run < timer.runs(); run++) {
+        std::fill(C.begin(), C.end(), Acc(0));
+        timer.start();
+
+        MPI_Bcast(A.data(), static_cast<int>(A.size()), mpi_type<T>(), 0, fiber_comm);
+        MPI_Bcast(B.data(), static_cast<int>(B.size()), mpi_type<T>(), 0, fiber_comm);
+
+        for (int k0 = layer_k.start; k0 < layer_k.start + layer_k.size; ) {
+            // A panel must not cross an A column block, B's row block or the layer's share
+            int a_owner = block_owner(K, dims[2], k0);
+            int b_owner = block_owner(K, dims[1], k0);
+            BlockRange a_k = block_range(K, dims[2], a_owner);
+            BlockRange b_k = block_range(K, dims[1], b_owner);
+            int width = std::min({options.panel, a_k.start + a_k.size - k0, b_k.start + b_k.size - k0,
+                                  layer_k.start + layer_k.size - k0});
+
+            if (coords[2] == a_owner) {
+                for (int i = 0; i < my_rows.size; i++) {
+                    std::copy_n(&A[static_cast<size_t>(i) * my_a_k.size + (k0 - my_a_k.start)], width,
+                                &a_panel[static_cast<size_t>(i) * width]);
+                }
+            }
+            if (coords[1] == b_owner) {
+                std::copy_n(&B[static_cast<size_t>(k0 - my_b_k.start) * my_cols.size],
+                            static_cast<size_t>(width) * my_cols.size, b_panel.begin());
+            }
+            MPI_Bcast(a_panel.data(), my_rows.size * width, mpi_type<T>(), a_owner, row_comm);
+            MPI_Bcast(b_panel.data(), width * my_cols.size, mpi_type<T>(), b_owner, col_comm);
+
+            pooled_gemm<T>(pool, my_rows.size, my_cols.size, width, a_panel.data(), width,
+                           b_panel.data(), my_cols.size, C.data(), my_cols.size, nullptr);
+            k0 += width;
+        }
+
+        MPI_Reduce(layer == 0 ? MPI_IN_PLACE : C.data(), C.data(), static_cast<int>(C.size()), mpi_type<Acc>(),
+                   MPI_SUM, 0, fiber_comm);
+
+        timer.stop();
+    }
+    const BenchStats& stats = timer.stats();
+
+    long errors = options.verify && layer == 0
+                      ? verify_block(C.data(), my_cols.size, my_rows, my_cols, K, VERIFY_SAMPLES) : 0;
+    MPI_Allreduce(MPI_IN_PLACE, &errors, 1, MPI_LONG, MPI_SUM, grid_comm);
+    long long most = stats.bytes;
+    MPI_Allreduce(MPI_IN_PLACE, &most, 1, MPI_LONG_LONG, MPI_MAX, grid_comm);
+
+    if (grid_rank == 0) {
+        double gflops = 2.0 * M * N * K / stats.best / 1e9;
+        std::cout << "2.5D SUMMA C[" << M << "x" << N << "] = A[" << M << "x" << K << "] * B[" << K << "x" << N
+                  << "] on " << layers << " layers of " << dims[1] << "x" << dims[2] << " x " << options.threads
+                  << (options.pin ? " pinned" : "") << " threads, panel " << options.panel
+                  << ", " << options.dtype << ", " << kernel_isa_name(kernel_isa()) << " kernel\n";
+        std::cout << std::fixed << std::setprecision(6)
+                  << "Time: best " << stats.best << " s, mean " << stats.mean << " s over "
+                  << options.reps << " runs, " << std::setprecision(2) << gflops << " GFLOP/s\n";
+        // Blocks go to c - 1 other layers, panels to the rest of their layer
+        // row or column, and C comes back from c - 1 layers
+        double replicated = (static_cast<double>(M) * K + static_cast<double>(K) * N) * (layers - 1) * sizeof(T);
+        double panels = (static_cast<double>(M) * K * (dims[2] - 1) +
+                         static_cast<double>(K) * N * (dims[1] - 1)) * sizeof(T);
+        double reduced = static_cast<double>(M) * N * (layers - 1) * sizeof(Acc);
+        std::cout << std::setprecision(1) << "Traffic: " << (replicated + panels + reduced) / (1 << 20)
+                  << " MiB between ranks (replication " << replicated / (1 << 20) << ", panels "
+                  << panels / (1 << 20) << ", reduction " << reduced / (1 << 20) << "), busiest rank sent "
+                  << most / double(1 << 20) << " MiB\n";
+        double blocks = (static_cast<double>(my_rows.size) * my_a_k.size +
+                         static_cast<double>(my_b_k.size) * my_cols.size) * sizeof(T);
+        std::cout << "Memory: " << blocks / (1 << 20) << " MiB of A and B blocks per rank, "
+                  << blocks * size / (1 << 20) << " MiB in all\n";
+        if (options.verify) {
+            std::cout << "Verification: " << (errors == 0 ? "passed" : "FAILED")
+                      << " (" << errors << " wrong sampled entries)\n";
+        }
+    }
+
+    bench_report(grid_comm, "matrix_mult", "gemm25d_c" + std::to_string(layers), gemm_size_label(options), stats);
+
+    MPI_Comm_free(&row_comm);
+    MPI_Comm_free(&col_comm);
+    MPI_Comm_free(&fiber_comm);
+    MPI_Comm_free(&grid_comm);
+}
+
+void multiply_matrices_25d(int rank, int size, const GemmOptions& options) {
+    if (options.dtype == "int8") {
+        summa_25d_gemm<int8_t>(rank, size, options);
+    } else if (options.dtype == "int16") {
+        summa_25d_gemm<int16_t>(rank, size, options);
+    } else if (options.dtype == "int32") {
+        summa_25d_gemm<int32_t>(rank, size, options);
+    } else if (options.dtype == "float") {
+        summa_25d_gemm<float>(rank, size, options);
+    } else {
+        summa_25d_gemm<double>(rank, size, options);
+    }
+}
+
+// Row-block GEMM in the spirit of the matrix4 mode, sized for real work.
+// Rank 0 owns A and B, scatters the rows of A once and broadcasts B in K
+// panels. With overlap the broadcast of panel p + 1 is started with
+// MPI_Ibcast before panel p is multiplied, so the transfer runs behind
+// the kernel instead of in front of it. C comes back with one MPI_Gatherv.
+template<typename T>
+static void pipelined_gemm(int rank, int size, const GemmOptions& options) {
+    typedef typename Accumulator<T>::type Acc;
+    const int M = options.m, K = options.k, N = options.n;
+    const BlockRange all_rows{0, M}, all_k{0, K}, all_cols{0, N};
+    BlockRange my_rows = block_range(M, size, rank);
+
+    std::vector<T> A, B;
+    std::vector<Acc> C;
+    if (rank == 0) {
+        fill_block(A, SEED_A, all_rows, all_k);
+        fill_block(B, SEED_B, all_k, all_cols);
+        C.resize(static_cast<size_t>(M) * N);
+    }
+
+    std::vector<int> a_counts(size), a_displs(size), c_counts(size), c_displs(size);
+    for (int r = 0; r < size; r++) {
+        BlockRange rows = block_range(M, size, r);
+        a_counts[r] = rows.size * K;
+        a_displs[r] = rows.start * K;
+        c_counts[r] = rows.size * N;
+        c_displs[r] = rows.start * N;
+    }
+
+    const int panel = std::min(options.panel, K);
+    const int num_panels = (K + panel - 1) / panel;
+    std::vector<T> my_a(static_cast<size_t>(my_rows.size) * K);
+    std::vector<Acc> my_c(static_cast<size_t>(my_rows.size) * N);
+    // Rank 0 broadcasts straight out of B, the others alternate two buffers
+    std::vector<T> b_buffers[2];
+    if (rank != 0) {
+        b_buffers[0].resize(static_cast<size_t>(panel) * N);
+        b_buffers[1].resize(static_cast<size_t>(panel) * N);
+    }
+
+    auto panel_width = [&](int p) { return std::min(panel, K - p * panel); };
+    auto panel_data = [&](int p) -> T* {
+        return rank == 0 ? &B[static_cast<size_t>(p) * panel * N] : b_buffers[p % 2].data();
+    };
+
+    ThreadPool pool(options.threads, options.pin, node_first_cpu(options));
+    MPI_Request pending = MPI_REQUEST_NULL;
+    // Most MPI libraries only progress a prefetch inside MPI calls
+    std::function<void()> poll = [&pending] {
+        if (pending != MPI_REQUEST_NULL) {
+            int done;
+            MPI_Test(&pending, &done, MPI_STATUS_IGNORE);
+        }
+    };
+
+    double best_wait = 0;
+    BenchTimer timer(MPI_COMM_WORLD, options.warmup, options.reps);
+    for (int run = 0; run < timer.runs(); run++) {
+        std::fill(my_c.begin(), my_c.end(), Acc(0));
+        timer.start();
+        double wait = 0;
+
+        MPI_Scatterv(A.data(), a_counts.data(), a_displs.data(), mpi_type<T>(),
+                     my_a.data(), my_rows.size * K, mpi_type<T>(), 0, MPI_COMM_WORLD);
+
+        if (options.overlap) {
+            MPI_Ibcast(panel_data(0), panel_width(0) * N, mpi_type<T>(), 0, MPI_COMM_WORLD, &pending);
+        }
+        for (int p = 0; p < num_panels; p++) {
+            double wait_start = MPI_Wtime();
+            if (options.overlap) {
+                MPI_Wait(&pending, MPI_STATUS_IGNORE);
+                // The other buffer was consumed by panel p - 1, so it is free
+                if (p + 1 < num_panels) {
+                    MPI_Ibcast(panel_data(p + 1), panel_width(p + 1) * N, mpi_type<T>(), 0,
+                               MPI_COMM_WORLD, &pending);
+                }
+            } else {
+                MPI_Bcast(panel_data(p), panel_width(p) * N, mpi_type<T>(), 0, MPI_COMM_WORLD);
+            }
+            wait += MPI_Wtime() - wait_start;
+
+            pooled_gemm<T>(pool, my_rows.size, N, panel_width(p), &my_a[static_cast<size_t>(p) * panel], K,
+                           panel_data(p), N, my_c.data(), N, poll);
+        }
+
+        MPI_Gatherv(my_c.data(), my_rows.size * N, mpi_type<Acc>(),
+                    C.data(), c_counts.data(), c_displs.data(), mpi_type<Acc>(), 0, MPI_COMM_WORLD);
+
+        timer.stop();
+        MPI_Allreduce(MPI_IN_PLACE, &wait, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+        if (timer.last_was_best()) {
+            best_wait = wait;
+        }
+    }
+    const BenchStats& stats = timer.stats();
+
+    if (rank == 0) {
+        double gflops = 2.0 * M * N * K / stats.best / 1e9;
+        // Everything but rank 0's own rows crosses a process boundary
+        BlockRange root_rows = block_range(M, size, 0);
+        double moved = static_cast<double>(M - root_rows.size) * (K * sizeof(T) + N * sizeof(Acc)) +
+                       static_cast<double>(size - 1) * K * N * sizeof(T);
+        std::cout << "Pipelined C[" << M << "x" << N << "] = A[" << M << "x" << K << "] * B[" << K << "x" << N
+                  << "] on " << size << " ranks x " << options.threads << (options.pin ? " pinned" : "")
+                  << " threads, " << num_panels << " B panels of " << panel << " rows, "
+                  << (options.overlap ? "Ibcast overlap" : "blocking Bcast") << ", " << options.dtype
+                  << ", " << kernel_isa_name(kernel_isa()) << " kernel\n";
+        std::cout << std::fixed << std::setprecision(6)
+                  << "Time: best " << stats.best << " s, mean " << stats.mean << " s over "
+                  << options.reps << " runs, " << std::setprecision(2) << gflops << " GFLOP/s\n";
+        std::cout << std::setprecision(1) << "Traffic: " << moved / (1 << 20) << " MiB between ranks\n";
+        std::cout << std::setprecision(6) << "Panel wait: " << best_wait << " s ("
+                  << std::setprecision(1) << 100.0 * best_wait / stats.best << "% of the best run, slowest rank)\n";
+        if (options.verify) {
+            long errors = verify_block(C.data(), N, all_rows, all_cols, K, VERIFY_SAMPLES);
+            std::cout << "Verification: " << (errors == 0 ? "passed" : "FAILED")
+                      << " (" << errors << " wrong sampled entries)\n";
+        }
+    }
+    bench_report(MPI_COMM_WORLD, "matrix_mult", "pipeline", gemm_size_label(options), stats);
+}
+
+void multiply_matrices_pipelined(int rank, int size, const GemmOptions& options) {
+    if (options.dtype == "int8") {
+        pipelined_gemm<int8_t>(rank, size, options);
+    } else if (options.dtype == "int16") {
+        pipelined_gemm<int16_t>(rank, size, options);
+    } else if (options.dtype == "int32") {
+        pipelined_gemm<int32_t>(rank, size, options);
+    } else if (options.dtype == "float") {
+        pipelined_gemm<float>(rank, size, options);
+    } else {
+        pipelined_gemm<double>(rank, size, options);
+    }
+}
+
+// Row-block GEMM like pipeline mode, with the operands held once per node
+// instead of once per rank. One NodeBuffer per node holds B and the node's
+// rows of A and C; the ranks of the node read A and B and write their C
+// rows in place. Only the node leaders move data: B is broadcast and the
+// rows of A scattered over the leader communicator, and C gathered back.
+// Rows follow the node-major order, so every node owns one contiguous run.
+template<typename T>
+static void shared_gemm(int rank, int size, const GemmOptions& options) {
+    typedef typename Accumulator<T>::type Acc;
+    const int M = options.m, K = options.k, N = options.n;
+    const BlockRange all_rows{0, M}, all_k{0, K}, all_cols{0, N};
+    const NodeTopology& topology = node_topology();
+    const bool leader = topology.node_rank == 0;
+
+    int first = topology.local_rank - topology.node_rank;
+    BlockRange my_rows = block_range(M, size, topology.local_rank);
+    BlockRange last_rows = block_range(M, size, first + topology.node_size - 1);
+    BlockRange node_rows{block_range(M, size, first).start, 0};
+    node_rows.size = last_rows.start + last_rows.size - node_rows.start;
+
+    const size_t b_elems = static_cast<size_t>(K) * N;
+    const size_t a_elems = static_cast<size_t>(node_rows.size) * K;
+    const size_t c_elems = static_cast<size_t>(node_rows.size) * N;
+    // C first, so the wider accumulators stay aligned ahead of narrow operands
+    NodeBuffer shared(c_elems * sizeof(Acc) + (b_elems + a_elems) * sizeof(T));
+    Acc* node_c = shared.as<Acc>();
+    T* B = reinterpret_cast<T*>(node_c + c_elems);
+    T* node_a = B + b_elems;
+    T* my_a = node_a + static_cast<size_t>(my_rows.start - node_rows.start) * K;
+    Acc* my_c = node_c + static_cast<size_t>(my_rows.start - node_rows.start) * N;
+
+    // Rank 0 is the source of A and B and the sink of C, as in pipeline mode
+    std::vector<T> A;
+    std::vector<Acc> C;
+    if (rank == 0) {
+        std::vector<T> b_source;
+        fill_block(b_source, SEED_B, all_k, all_cols);
+        std::copy(b_source.begin(), b_source.end(), B);
+        fill_block(A, SEED_A, all_rows, all_k);
+        C.resize(static_cast<size_t>(M) * N);
+    }
+
+    std::vector<int> a_counts, a_displs, c_counts, c_displs;
+    if (leader) {
+        int mine[2] = {node_rows.start, node_rows.size};
+        std::vector<int> all(2 * topology.nodes);
+        MPI_Allgather(mine, 2, MPI_INT, all.data(), 2, MPI_INT, topology.leaders);
+        for (int node = 0; node < topology.nodes; node++) {
+            a_counts.push_back(all[2 * node + 1] * K);
+            a_displs.push_back(all[2 * node] * K);
+            c_counts.push_back(all[2 * node + 1] * N);
+            c_displs.push_back(all[2 * node] * N);
+        }
+    }
+    shared.sync();
+
+    ThreadPool pool(options.threads, options.pin, node_first_cpu(options));
+    BenchTimer timer(MPI_COMM_WORLD, options.warmup, options.reps);
+    for (int run = 0; run < timer.runs(); run++) {
+        timer.start();
+        if (leader) {
+            MPI_Bcast(B, static_cast<int>(b_elems), mpi_type<T>(), 0, topology.leaders);
+            MPI_Scatterv(A.data(), a_counts.data(), a_displs.data(), mpi_type<T>(),
+                         node_a, static_cast<int>(a_elems), mpi_type<T>(), 0, topology.leaders);
+        }
+        // Cleared after the start barrier: until then the leader may still
+        // be gathering the previous run's C
+        std::fill(my_c, my_c + static_cast<size_t>(my_rows.size) * N, Acc(0));
+        shared.sync();
+
+        pooled_gemm<T>(pool, my_rows.size, N, K, my_a, K, B, N, my_c, N, nullptr);
+
+        shared.sync();
+        if (leader) {
+            MPI_Gatherv(node_c, static_cast<int>(c_elems), mpi_type<Acc>(),
+                        C.data(), c_counts.data(), c_displs.data(), mpi_type<Acc>(), 0, topology.leaders);
+        }
+        timer.stop();
+    }
+    const BenchStats& stats = timer.stats();
+
+    if (rank == 0) {
+        double gflops = 2.0 * M * N * K / stats.best / 1e9;
+        // Only the leaders' traffic crosses a node boundary
+        double moved = static_cast<double>(M - node_rows.size) * (K * sizeof(T) + N * sizeof(Acc)) +
+                       static_cast<double>(topology.nodes - 1) * K * N * sizeof(T);
+        double per_node = static_cast<double>(shared.size()) / (1 << 20);
+        double copied = (static_cast<double>(topology.node_size) * b_elems + a_elems) * sizeof(T) +
+                        static_cast<double>(c_elems) * sizeof(Acc);
+        std::cout << "Shared C[" << M << "x" << N << "] = A[" << M << "x" << K << "] * B[" << K << "x" << N
+                  << "] on " << size << " ranks x " << options.threads << (options.pin ? " pinned" : "")
+                  << " threads, " << topology.nodes << " node(s), " << options.dtype << ", "
+                  << kernel_isa_name(kernel_isa()) << " kernel\n";
+        std::cout << std::fixed << std::setprecision(6)
+                  << "Time: best " << stats.best << " s, mean " << stats.mean << " s over "
+                  << options.reps << " runs, " << std::setprecision(2) << gflops << " GFLOP/s\n";
+        std::cout << std::setprecision(1) << "Traffic: " << moved / (1 << 20) << " MiB between nodes\n";
+        std::cout << "Node memory: " << per_node << " MiB shared on node 0, " << copied / (1 << 20)
+                  << " MiB with a copy of B per rank\n";
+        if (options.verify) {
+            long errors = verify_block(C.data(), N, all_rows, all_cols, K, VERIFY_SAMPLES);
+            std::cout << "Verification: " << (errors == 0 ? "passed" : "FAILED")
+                      << " (" << errors << " wrong sampled entries)\n";
+        }
+    }
+    bench_report(MPI_COMM_WORLD, "matrix_mult", "shared", gemm_size_label(options), stats);
+}
+
+void multiply_matrices_shared(int rank, int size, const GemmOptions& options) {
+    if (options.dtype == "int8") {
+        shared_gemm<int8_t>(rank, size, options);
+    } else if (options.dtype == "int16") {
+        shared_gemm<int16_t>(rank, size, options);
+    } else if (options.dtype == "int32") {
+        shared_gemm<int32_t>(rank, size, options);
+    } else if (options.dtype == "float") {
+        shared_gemm<float>(rank, size, options);
+    } else {
+        shared_gemm<double>(rank, size, options);
+    }
+}
+
+template<typename T>
+using BatchedKernel = void (*)(int, const T*, const T*, T*);
+
+// The compiled kernel for a runtime shape, or nullptr if it has none
+template<typename T>
+static BatchedKernel<T> batched_kernel_for(int m, int k, int n) {
+#define BATCHED_SHAPE_CASE(unused, M, K, N) \
+    if (m == M && k == K && n == N) {       \
+        return &batched_gemm<M, K, N, T>;   \
+    }
+    BATCHED_GEMM_SHAPES(BATCHED_SHAPE_CASE, _)
+#undef BATCHED_SHAPE_CASE
+    return nullptr;
+}
+
+static std::string batched_shape_list() {
+    std::string list;
+#define BATCHED_SHAPE_NAME(unused, M, K, N) list += " " #M "x" #K "x" #N;
+    BATCHED_GEMM_SHAPES(BATCHED_SHAPE_NAME, _)
+#undef BATCHED_SHAPE_NAME
+    return list;
+}
+
+// Element e of product b's A or B, generated from the batch index like the
+// big operands are from their coordinates
+template<typename T>
+static void fill_batch(std::vector<T>& data, unsigned seed, int elements, BlockRange products) {
+    data.assign(batched_size(elements, products.size), T(0));
+    for (int b = 0; b < products.size; b++) {
+        for (int e = 0; e < elements; e++) {
+            data[batched_index(elements, b, e)] = static_cast<T>(matrix_value(seed, products.start + b, e));
+        }
+    }
+}
+
+// Every rank owns a run of whole slices and generates its own products, so
+// the batch needs no messages at all; the pool shares out groups of slices.
+// For comparison the rank's products are also multiplied once each through
+// local_gemm, stored one after another the usual way.
+template<typename T>
+static void batched_products(int rank, int size, const GemmOptions& options) {
+    const int M = options.m, K = options.k, N = options.n;
+    BatchedKernel<T> kernel = batched_kernel_for<T>(M, K, N);
+    if (!kernel) {
+        if (rank == 0) {
+            std::cerr << "No batched kernel for " << gemm_size_label(options)
+                      << "; compiled shapes:" << batched_shape_list() << "\n";
+        }
+        return;
+    }
+
+    const int S = BATCHED_GEMM_SLICE;
+    const int slices = (options.count + S - 1) / S;
+    BlockRange my_slices = block_range(slices, size, rank);
+    BlockRange mine{my_slices.start * S, std::min(options.count - my_slices.start * S, my_slices.size * S)};
+    mine.size = std::max(0, mine.size);
+    std::vector<T> A, B, C(batched_size(M * N, mine.size));
+    fill_batch(A, SEED_A, M * K, mine);
+    fill_batch(B, SEED_B, K * N, mine);
+
+    // A few slices per task keep the pool's per-task cost out of the way
+    const int group = 16;
+    const int groups = (my_slices.size + group - 1) / group;
+    ThreadPool pool(options.threads, options.pin, node_first_cpu(options));
+    BenchTimer timer(MPI_COMM_WORLD, options.warmup, options.reps);
+    for (int run = 0; run < timer.runs(); run++) {
+        timer.start();
+        pool.parallel_for(groups, [&](int g, int) {
+            int first = g * group * S;
+            int count = std::min(group * S, mine.size - first);
+            kernel(count, &A[batched_index(M * K, first, 0)], &B[batched_index(K * N, first, 0)],
+                   &C[batched_index(M * N, first, 0)]);
+        });
+        timer.stop();
+    }
+    const BenchStats& stats = timer.stats();
+
+    // The same products one call each on row-major copies
+    std::vector<T> a(static_cast<size_t>(mine.size) * M * K), b(static_cast<size_t>(mine.size) * K * N);
+    std::vector<T> c(static_cast<size_t>(mine.size) * M * N, T(0));
+    for (int p = 0; p < mine.size; p++) {
+        for (int e = 0; e < M * K; e++) {
+            a[static_cast<size_t>(p) * M * K + e] = A[batched_index(M * K, p, e)];
+        }
+        for (int e = 0; e < K * N; e++) {
+            b[static_cast<size_t>(p) * K * N + e] = B[batched_index(K * N, p, e)];
+        }
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    double start = MPI_Wtime();
+    pool.parallel_for(groups, [&](int g, int) {
+        int last = std::min((g + 1) * group * S, mine.size);
+        for (int p = g * group * S; p < last; p++) {
+            local_gemm(M, N, K, &a[static_cast<size_t>(p) * M * K], K, &b[static_cast<size_t>(p) * K * N], N,
+                       &c[static_cast<size_t>(p) * M * N], N);
+        }
+    });
+    double single = MPI_Wtime() - start;
+    MPI_Allreduce(MPI_IN_PLACE, &single, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+
+    // Sampled products, each checked in full and against the single calls
+    long errors = 0;
+    if (options.verify) {
+        for (int s = 0; s < VERIFY_SAMPLES && mine.size > 0; s++) {
+            int p = static_cast<int>(static_cast<long long>(s) * (mine.size - 1) / std::max(1, VERIFY_SAMPLES - 1));
+            for (int i = 0; i < M; i++) {
+                for (int j = 0; j < N; j++) {
+                    double expected = 0;
+                    for (int q = 0; q < K; q++) {
+                        expected += matrix_value(SEED_A, mine.start + p, i * K + q) *
+                                    matrix_value(SEED_B, mine.start + p, q * N + j);
+                    }
+                    T got = C[batched_index(M * N, p, i * N + j)];
+                    if (static_cast<double>(got) != expected || got != c[static_cast<size_t>(p) * M * N + i * N + j]) {
+                        errors++;
+                    }
+                }
+            }
+        }
+        MPI_Allreduce(MPI_IN_PLACE, &errors, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+    }
+
+    if (rank == 0) {
+        double flops = 2.0 * M * N * K * options.count;
+        std::cout << "Batched " << options.count << " x C[" << M << "x" << N << "] = A[" << M << "x" << K
+                  << "] * B[" << K << "x" << N << "] on " << size << " ranks x " << options.threads
+                  << (options.pin ? " pinned" : "") << " threads, " << options.dtype << ", "
+                  << kernel_isa_name(kernel_isa()) << " kernel, slices of " << S << "\n";
+        std::cout << std::fixed << std::setprecision(6)
+                  << "Time: best " << stats.best << " s, mean " << stats.mean << " s over "
+                  << options.reps << " runs, " << std::setprecision(2) << flops / stats.best / 1e9 << " GFLOP/s, "
+                  << options.count / stats.best / 1e6 << " M products/s\n";
+        std::cout << std::setprecision(6) << "Single calls: " << single << " s through local_gemm, "
+                  << std::setprecision(2) << single / stats.best << "x slower\n";
+        if (options.verify) {
+            std::cout << "Verification: " << (errors == 0 ? "passed" : "FAILED")
+                      << " (" << errors << " wrong sampled entries)\n";
+        }
+    }
+    bench_report(MPI_COMM_WORLD, "matrix_mult", "batched",
+                 gemm_size_label(options) + "*" + std::to_string(options.count), stats);
+}
+
+void multiply_matrices_batched(int rank, int size, const GemmOptions& options) {
+    if (options.dtype == "int32") {
+        batched_products<int32_t>(rank, size, options);
+    } else if (options.dtype == "float") {
+        batched_products<float>(rank, size, options);
+    } else {
+        batched_products<double>(rank, size, options);
+    }
+}
+
+template<typename T>
+static void write_operands(int rank, int size, const GemmOptions& options) {
+    const int M = options.m, K = options.k, N = options.n;
+    BlockRange a_rows = block_range(M, size, rank);
+    BlockRange b_rows = block_range(K, size, rank);
+    std::vector<T> A, B;
+    fill_block(A, SEED_A, a_rows, {0, K});
+    fill_block(B, SEED_B, b_rows, {0, N});
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double start = MPI_Wtime();
+    bool written = write_matrix_tile(MPI_COMM_WORLD, options.a_file, M, K, mpi_type<T>(),
+                                     {a_rows.start, 0, a_rows.size, K}, A.data()) &&
+                   write_matrix_tile(MPI_COMM_WORLD, options.b_file, K, N, mpi_type<T>(),
+                                     {b_rows.start, 0, b_rows.size, N}, B.data());
+    double elapsed = MPI_Wtime() - start;
+    MPI_Allreduce(MPI_IN_PLACE, &elapsed, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+
+    if (rank == 0 && written) {
+        double bytes = (static_cast<double>(M) * K + static_cast<double>(K) * N) * sizeof(T);
+        std::cout << "Wrote A[" << M << "x" << K << "] to " << options.a_file << " and B[" << K << "x" << N
+                  << "] to " << options.b_file << ", " << options.dtype << ", from " << size << " ranks\n";
+        std::cout << std::fixed << std::setprecision(3) << "Write: " << bytes / (1 << 20) << " MiB in "
+                  << elapsed << " s, " << std::setprecision(1) << bytes / (1 << 20) / elapsed << " MiB/s\n";
+    }
+}
+
+void write_gemm_operands(int rank, int size, const GemmOptions& options) {
+    if (options.dtype == "int32") {
+        write_operands<int32_t>(rank, size, options);
+    } else if (options.dtype == "float") {
+        write_operands<float>(rank, size, options);
+    } else {
+        write_operands<double>(rank, size, options);
+    }
+}
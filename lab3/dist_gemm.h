@@ -0,0 +1,79 @@
+#ifndef DIST_GEMM_H
+#define DIST_GEMM_H
+
+#include <mpi.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Options shared by the distributed GEMM modes, given as key=value
+// arguments after the mode name, e.g. "gemm size=2048 grid=2x4 panel=128".
+struct GemmOptions {
+    int m = 1024;
+    int k = 1024;
+    int n = 1024;
+    int grid_rows = 0;  // 0 lets MPI_Dims_create pick the process grid
+    int grid_cols = 0;
+    int panel = 256;    // Width of the K panels broadcast per SUMMA step
+    int layers = 1;     // gemm25d: replication factor c, the depth of the process grid
+    int count = 65536;  // batched: independent m x k x n products over all ranks
+    bool overlap = true; // Pipeline mode: prefetch the next B panel while computing
+    std::string dtype = "double"; // Element type: int8, int16, int32, float or double
+    int threads = 1;    // Pool threads per rank running the local multiply
+    bool pin = false;   // Bind each pool thread to its own CPU
+    int warmup = 0;     // Untimed runs before the timed ones
+    int reps = 1;
+    bool verify = true;  // Checks against the generated operands; off by default with a= and b=
+    std::string a_file; // gemm: read A and B from matrix files instead of generating
+    std::string b_file; // them (genmat: write the generated ones there)
+    std::string c_file; // gemm: write C to this matrix file
+    std::string checkpoint; // gemm: directory for every rank's checkpoint files
+    int interval = 8;   // gemm: K panel steps between checkpoints
+    bool restart = false; // gemm: resume the first run from the last complete checkpoint
+    int fail = 0;       // gemm: abort the job after this many panel steps of the first run
+};
+
+// Contiguous share of n items owned by part index of parts; the first
+// n % parts parts get one extra item.
+struct BlockRange {
+    int start;
+    int size;
+};
+
+template<typename T> MPI_Datatype mpi_type();
+template<> inline MPI_Datatype mpi_type<int8_t>() { return MPI_INT8_T; }
+template<> inline MPI_Datatype mpi_type<int16_t>() { return MPI_INT16_T; }
+template<> inline MPI_Datatype mpi_type<int32_t>() { return MPI_INT32_T; }
+template<> inline MPI_Datatype mpi_type<float>() { return MPI_FLOAT; }
+template<> inline MPI_Datatype mpi_type<double>() { return MPI_DOUBLE; }
+
+// Element type of C for operands of type T: int8 and int16 operands
+// accumulate into int32, everything else into its own type
+template<typename T> struct Accumulator { typedef T type; };
+template<> struct Accumulator<int8_t> { typedef int32_t type; };
+template<> struct Accumulator<int16_t> { typedef int32_t type; };
+
+bool parse_gemm_options(int argc, char** argv, int first, GemmOptions& options);
+BlockRange block_range(int n, int parts, int index);
+int block_owner(int n, int parts, int item);
+
+// Operands are generated from their global coordinates, so every rank can
+// build its own tiles without anything going through rank 0.
+double matrix_value(unsigned seed, long long row, long long col);
+template<typename T>
+void fill_block(std::vector<T>& block, unsigned seed, BlockRange rows, BlockRange cols);
+template<typename T>
+long verify_block(const T* C, int ldc, BlockRange rows, BlockRange cols, int k, int samples);
+
+void multiply_matrices_summa(int rank, int size, const GemmOptions& options);
+void multiply_matrices_25d(int rank, int size, const GemmOptions& options);
+void multiply_matrices_pipelined(int rank, int size, const GemmOptions& options);
+void multiply_matrices_shared(int rank, int size, const GemmOptions& options);
+// count small products of one of the BATCHED_GEMM_SHAPES, split over the
+// ranks by whole slices of the batched layout
+void multiply_matrices_batched(int rank, int size, const GemmOptions& options);
+// Writes the generated A and B of the given shape to options.a_file and
+// options.b_file, each rank writing its block of rows
+void write_gemm_operands(int rank, int size, const GemmOptions& options);
+
+#endif // DIST_GEMM_H
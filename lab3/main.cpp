@@ -1,17 +1,35 @@
 #include "matrix_mult.h"
 #include "car_race.h"
+#include "dist_gemm.h"
+#include "bench.h"
 #include <iostream>
 
 int main(int argc, char** argv) {
-    MPI_Init(&argc, &argv);
+    // Only the thread that initialized MPI makes MPI calls; pool threads compute
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
 
     int rank, size;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
 
-    if (argc != 2) {
+    if (argc < 2) {
         if (rank == 0) {
-            std::cout << "Usage: " << argv[0] << " [car_race|matrix4|matrix20]\n";
+            std::cout << "Usage: " << argv[0] << " [car_race|matrix4|matrix20|gemm|gemm25d|pipeline|shared|batched|genmat] [options]\n";
+            std::cout << "  car_race options: [headless] [min_delay=MS] [max_delay=MS] [lead=MS] [seed=N]\n"
+                      << "                    [progress=send|pool|rma]\n";
+            std::cout << "  gemm options: [size=N | m=M k=K n=N] [grid=PxQ] [panel=W]\n"
+                      << "                [dtype=int8|int16|int32|float|double] [threads=T] [pin=0|1]\n"
+                      << "                [warmup=W] [reps=R] [verify=0|1] [a=FILE b=FILE] [c=FILE]\n"
+                      << "                [checkpoint=DIR [interval=STEPS] [restart=1]] [fail=STEPS]\n";
+            std::cout << "  gemm25d options: gemm options without files, plus [layers=C]; grid=PxQ is a layer\n";
+            std::cout << "  pipeline options: gemm options without grid, plus [overlap=0|1]\n";
+            std::cout << "  shared options: gemm options without grid and panel\n";
+            std::cout << "  batched options: [m=4 k=5 n=6 | size=N] [count=C] [dtype=int32|float|double] [threads=T] [pin=0|1]\n"
+                      << "                   [warmup=W] [reps=R] [verify=0|1]\n";
+            std::cout << "  genmat options: a=FILE b=FILE [size=N | m=M k=K n=N] [dtype=int32|float|double]\n";
+            std::cout << "  matrix4 options: [warmup=W] [reps=R]\n";
+            std::cout << "  matrix20 options: [placement=node|world] [warmup=W] [reps=R]\n";
         }
         MPI_Finalize();
         return 1;
@@ -20,25 +38,94 @@ int main(int argc, char** argv) {
     std::string mode(argv[1]);
 
     if (mode == "car_race") {
-        if (size != CarRace::NUM_CARS + 1) {
+        RaceOptions options;
+        if (!parseRaceOptions(argc, argv, 2, options)) {
             if (rank == 0) {
-                std::cerr << "Car race requires " << CarRace::NUM_CARS + 1 << " processes\n";
+                std::cerr << "Invalid car_race options\n";
             }
             MPI_Finalize();
             return 1;
         }
+        if (size < 2) {
+            if (rank == 0) {
+                std::cerr << "Car race requires a referee and at least one car process\n";
+            }
+            MPI_Finalize();
+            return 1;
+        }
+        options.numCars = size - 1;
         if (CarRace::isReferee(rank)) {
-            runRefereeProcess();
+            runRefereeProcess(options);
         } else if (CarRace::isCarProcess(rank)) {
-            runCarProcess(rank);
+            runCarProcess(rank, options);
+        }
+    } else if (mode == "matrix4" || mode == "matrix20") {
+        int warmup = 0, reps = 1;
+        bool by_node = true, valid = true;
+        int first = 2;
+        std::string placement = argc > 2 ? argv[2] : "";
+        if (mode == "matrix20" && placement.compare(0, 10, "placement=") == 0) {
+            valid = placement == "placement=node" || placement == "placement=world";
+            by_node = placement != "placement=world";
+            first = 3;
+        }
+        if (!valid || !parse_bench_args(argc, argv, first, warmup, reps)) {
+            if (rank == 0) {
+                std::cerr << "Invalid " << mode << " options\n";
+            }
+            MPI_Finalize();
+            return 1;
+        }
+        if (mode == "matrix4") {
+            multiply_matrices_mpi_4(rank, size, warmup, reps);
+        } else {
+            multiply_matrices_mpi_20(rank, size, warmup, reps, by_node);
+        }
+    } else if (mode == "gemm" || mode == "gemm25d" || mode == "pipeline" || mode == "shared" || mode == "batched" ||
+               mode == "genmat") {
+        GemmOptions options;
+        if (mode == "batched") {
+            options.m = 4; // Small products: the shapes come from BATCHED_GEMM_SHAPES
+            options.k = 5;
+            options.n = 6;
+        }
+        bool parsed = parse_gemm_options(argc, argv, 2, options);
+        // Only SUMMA reads and writes matrix files and checkpoints; genmat needs both names
+        bool reads = !options.a_file.empty() || !options.c_file.empty() || !options.checkpoint.empty() ||
+                     options.fail > 0;
+        if (mode == "genmat") {
+            parsed = parsed && !options.a_file.empty() && options.c_file.empty() && options.checkpoint.empty() &&
+                     options.fail == 0;
+        } else if (mode != "gemm") {
+            parsed = parsed && !reads;
+        }
+        // Narrow operands only exist in the multiplies; C is int32 there
+        if (mode == "batched" || mode == "genmat") {
+            parsed = parsed && options.dtype != "int8" && options.dtype != "int16";
+        }
+        if (!parsed) {
+            if (rank == 0) {
+                std::cerr << "Invalid " << mode << " options\n";
+            }
+            MPI_Finalize();
+            return 1;
+        }
+        if (mode == "gemm") {
+            multiply_matrices_summa(rank, size, options);
+        } else if (mode == "gemm25d") {
+            multiply_matrices_25d(rank, size, options);
+        } else if (mode == "genmat") {
+            write_gemm_operands(rank, size, options);
+        } else if (mode == "batched") {
+            multiply_matrices_batched(rank, size, options);
+        } else if (mode == "pipeline") {
+            multiply_matrices_pipelined(rank, size, options);
+        } else {
+            multiply_matrices_shared(rank, size, options);
         }
-    } else if (mode == "matrix4") {
-        multiply_matrices_mpi_4(rank, size);
-    } else if (mode == "matrix20") {
-        multiply_matrices_mpi_20(rank, size);
     } else {
         if (rank == 0) {
-            std::cout << "Invalid mode. Use: car_race, matrix4, or matrix20\n";
+            std::cout << "Invalid mode. Use: car_race, matrix4, matrix20, gemm, gemm25d, pipeline, shared, batched, or genmat\n";
         }
     }
 
@@ -1,4 +1,8 @@
 #include "matrix_mult.h"
+#include "gemm_kernel.h"
+#include "bench.h"
+#include "topology.h"
+#include <algorithm>
 
 void initialize_matrices(
     std::array<std::array<int, 5>, 4>& A, 
@@ -25,7 +29,7 @@ void initialize_matrices(
 }
 
 
-void multiply_matrices_mpi_20(int rank, int size) {
+void multiply_matrices_mpi_20(int rank, int size, int warmup, int reps, bool by_node) {
     const int ROWS_A = 4, COLS_A = 5, ROWS_B = 5, COLS_B = 6;
     const int GROUP_SIZE = 5;
 
@@ -33,53 +37,78 @@ void multiply_matrices_mpi_20(int rank, int size) {
     std::array<std::array<int, COLS_B>, ROWS_B> B;
     std::array<std::array<int, ROWS_B>, COLS_B> BT;
     std::array<std::array<int, COLS_B>, ROWS_A> result;
-    
-    auto start_time = std::chrono::high_resolution_clock::now();
-    
-    MPI_Comm leader_comm, member_comm;
-    MPI_Comm_split(MPI_COMM_WORLD, rank % GROUP_SIZE == 0, rank, &leader_comm);
-    MPI_Comm_split(MPI_COMM_WORLD, rank / GROUP_SIZE, rank, &member_comm);
 
     if (rank == 0) {
         initialize_matrices(A, B, BT);
     }
 
-    int my_a, my_b;
-    MPI_Scatter(A.data(), 1, MPI_INT, &my_a, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    // Node placement takes the groups of five from the topology cache, cut
+    // from the node-major rank order so each group's reduction stays on one
+    // node; the first run builds them. World placement splits world-order
+    // groups in every run, as each call used to. Position 0 is world rank 0
+    // either way.
+    BenchTimer timer(MPI_COMM_WORLD, warmup, reps);
+    for (int run = 0; run < timer.runs(); run++) {
+        timer.start();
 
-    for (int i = 0; i < COLS_B; i++) {
-        std::array<int, ROWS_B> b_row;
-        MPI_Bcast(BT[i].data(), ROWS_B, MPI_INT, 0, leader_comm);
-        b_row = BT[i];
-        MPI_Scatter(b_row.data(), 1, MPI_INT, &my_b, 1, MPI_INT, 0, member_comm);
-        
-        int local_result = my_a * my_b;
-        
-        int group_result;
-        MPI_Reduce(&local_result, &group_result, 1, MPI_INT, MPI_SUM, 0, member_comm);
-        
-        if (rank % GROUP_SIZE == 0) {
-            int row_idx = rank / GROUP_SIZE;
-            result[row_idx][i] = group_result;
+        MPI_Comm comm, leader_comm, member_comm;
+        int position;
+        if (by_node) {
+            const RankGroups& groups = rank_groups(GROUP_SIZE);
+            comm = node_topology().local;
+            position = node_topology().local_rank;
+            leader_comm = groups.leaders;
+            member_comm = groups.members;
+        } else {
+            comm = MPI_COMM_WORLD;
+            position = rank;
+            MPI_Comm_split(MPI_COMM_WORLD, rank % GROUP_SIZE == 0, rank, &leader_comm);
+            MPI_Comm_split(MPI_COMM_WORLD, rank / GROUP_SIZE, rank, &member_comm);
+        }
+        bool leader = position % GROUP_SIZE == 0;
 
-            MPI_Gather(result[row_idx].data(), COLS_B, MPI_INT, result.data(), COLS_B, MPI_INT, 0, leader_comm);
+        int my_a, my_b;
+        MPI_Scatter(A.data(), 1, MPI_INT, &my_a, 1, MPI_INT, 0, comm);
+
+        for (int i = 0; i < COLS_B; i++) {
+            std::array<int, ROWS_B> b_row;
+            if (leader) {
+                MPI_Bcast(BT[i].data(), ROWS_B, MPI_INT, 0, leader_comm);
+            }
+            b_row = BT[i];
+            MPI_Scatter(b_row.data(), 1, MPI_INT, &my_b, 1, MPI_INT, 0, member_comm);
+            
+            int local_result = my_a * my_b;
+            
+            int group_result;
+            MPI_Reduce(&local_result, &group_result, 1, MPI_INT, MPI_SUM, 0, member_comm);
+            
+            if (leader) {
+                int row_idx = position / GROUP_SIZE;
+                result[row_idx][i] = group_result;
+
+                MPI_Gather(result[row_idx].data(), COLS_B, MPI_INT, result.data(), COLS_B, MPI_INT, 0, leader_comm);
+            }
         }
+
+        if (!by_node) {
+            MPI_Comm_free(&leader_comm);
+            MPI_Comm_free(&member_comm);
+        }
+        timer.stop();
     }
     
-    auto end_time = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time).count();
-    
     if (rank == 0) {
         std::cout << "Result Matrix C:\n";
         print_matrix(result);
-        std::cout << "20-processor computation time: " << duration << " microseconds" << std::endl;
+        std::cout << "20-processor computation time: " << static_cast<long>(timer.stats().best * 1e6)
+                  << " microseconds (best of " << reps << ", " << (by_node ? "node" : "world")
+                  << " placement)" << std::endl;
     }
-
-    MPI_Comm_free(&leader_comm);
-    MPI_Comm_free(&member_comm);
+    bench_report(MPI_COMM_WORLD, "matrix_mult", by_node ? "matrix20" : "matrix20_world", "4x5x6", timer.stats());
 }
 
-void multiply_matrices_mpi_4(int rank, int size) {
+void multiply_matrices_mpi_4(int rank, int size, int warmup, int reps) {
     const int ROWS_A = 4, COLS_A = 5, ROWS_B = 5, COLS_B = 6;
    
     std::array<std::array<int, COLS_A>, ROWS_A> A;
@@ -87,36 +116,35 @@ void multiply_matrices_mpi_4(int rank, int size) {
     std::array<std::array<int, ROWS_B>, COLS_B> BT;
     std::array<std::array<int, COLS_B>, ROWS_A> result;
 
-    auto start_time = std::chrono::high_resolution_clock::now();
-    
     if (rank == 0) {
         initialize_matrices(A, B, BT);
     }
 
-    std::array<int, COLS_A> my_a_row;
-    MPI_Scatter(A.data(), COLS_A, MPI_INT, my_a_row.data(), COLS_A, MPI_INT, 0, MPI_COMM_WORLD);
-    std::array<int, COLS_B> my_result_row;
-    
-    for (int j = 0; j < COLS_B; j++) {
-        std::array<int, ROWS_B> bt_col;
-        MPI_Bcast(BT[j].data(), ROWS_B, MPI_INT, 0, MPI_COMM_WORLD);
-        bt_col = BT[j];
+    BenchTimer timer(MPI_COMM_WORLD, warmup, reps);
+    for (int run = 0; run < timer.runs(); run++) {
+        timer.start();
+
+        std::array<int, COLS_A> my_a_row;
+        MPI_Scatter(A.data(), COLS_A, MPI_INT, my_a_row.data(), COLS_A, MPI_INT, 0, MPI_COMM_WORLD);
+        std::array<int, COLS_B> my_result_row{};
         
-        int dot_product = 0;
-        for (int k = 0; k < COLS_A; k++) {
-            dot_product += my_a_row[k] * bt_col[k];
+        for (int j = 0; j < COLS_B; j++) {
+            MPI_Bcast(BT[j].data(), ROWS_B, MPI_INT, 0, MPI_COMM_WORLD);
         }
-        my_result_row[j] = dot_product;
+
+        // Row of C = BT * row of A, one dot product per column of B
+        local_gemv<int32_t>(COLS_B, COLS_A, &BT[0][0], ROWS_B, my_a_row.data(), my_result_row.data());
+        
+        MPI_Gather(my_result_row.data(), COLS_B, MPI_INT, result.data(), COLS_B, MPI_INT, 0, MPI_COMM_WORLD);
+
+        timer.stop();
     }
     
-    MPI_Gather(my_result_row.data(), COLS_B, MPI_INT, result.data(), COLS_B, MPI_INT, 0, MPI_COMM_WORLD);
-    
-    auto end_time = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time).count();
-    
     if (rank == 0) {
         std::cout << "Result Matrix C:\n";
         print_matrix(result);
-        std::cout << "4-processor computation time: " << duration << " microseconds" << std::endl;
+        std::cout << "4-processor computation time: " << static_cast<long>(timer.stats().best * 1e6)
+                  << " microseconds (best of " << reps << ")" << std::endl;
     }
+    bench_report(MPI_COMM_WORLD, "matrix_mult", "matrix4", "4x5x6", timer.stats());
 }
\ No newline at end of file
@@ -18,7 +18,9 @@ void print_matrix(const std::array<std::array<int, Cols>, Rows>& matrix) {
     }
 }
 
-void multiply_matrices_mpi_20(int rank, int size);
-void multiply_matrices_mpi_4(int rank, int size);
+// by_node: groups of five from the cached node topology; otherwise
+// world-order groups split in every run
+void multiply_matrices_mpi_20(int rank, int size, int warmup = 0, int reps = 1, bool by_node = true);
+void multiply_matrices_mpi_4(int rank, int size, int warmup = 0, int reps = 1);
 
 #endif // MATRIX_MULT_H 
\ No newline at end of file
@@ -0,0 +1,168 @@
+#include "progress_channel.h"
+#include "car_race.h"
+#include <algorithm>
+
+bool parseProgressMode(const std::string& name, ProgressMode& mode) {
+    if (name == "send") {
+        mode = ProgressMode::Send;
+    } else if (name == "pool") {
+        mode = ProgressMode::Pool;
+    } else if (name == "rma") {
+        mode = ProgressMode::Rma;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* progressModeName(ProgressMode mode) {
+    switch (mode) {
+        case ProgressMode::Pool: return "pool";
+        case ProgressMode::Rma: return "rma";
+        default: return "send";
+    }
+}
+
+ProgressChannel::ProgressChannel(ProgressMode mode, int numCars, int rank)
+    : mode(mode), numCars(numCars), rank(rank) {
+    bool referee = CarRace::isReferee(rank);
+
+    if (mode == ProgressMode::Pool) {
+        if (referee) {
+            inbox.assign(numCars + 1, 0);
+            recvRequests.resize(numCars);
+            for (int car = 1; car <= numCars; car++) {
+                MPI_Recv_init(&inbox[car], 1, MPI_INT, car, CarRace::PROGRESS_TAG,
+                              MPI_COMM_WORLD, &recvRequests[car - 1]);
+            }
+            MPI_Startall(numCars, recvRequests.data());
+        } else {
+            MPI_Ssend_init(&outbox, 1, MPI_INT, CarRace::REFEREE_RANK, CarRace::PROGRESS_TAG,
+                           MPI_COMM_WORLD, &sendRequest);
+        }
+    } else if (mode == ProgressMode::Rma) {
+        // Slot i holds the latest position of car i; cars expose nothing
+        if (referee) {
+            window.assign(numCars + 1, 0);
+            MPI_Win_create(window.data(), window.size() * sizeof(int), sizeof(int),
+                           MPI_INFO_NULL, MPI_COMM_WORLD, &win);
+        } else {
+            MPI_Win_create(nullptr, 0, sizeof(int), MPI_INFO_NULL, MPI_COMM_WORLD, &win);
+        }
+    }
+}
+
+ProgressChannel::~ProgressChannel() {
+    if (mode == ProgressMode::Pool) {
+        if (sendRequest != MPI_REQUEST_NULL) {
+            MPI_Wait(&sendRequest, MPI_STATUS_IGNORE);
+            MPI_Request_free(&sendRequest);
+        }
+        for (MPI_Request& request : recvRequests) {
+            // Still posted for an update that will never come
+            MPI_Cancel(&request);
+            MPI_Wait(&request, MPI_STATUS_IGNORE);
+            MPI_Request_free(&request);
+        }
+    } else if (mode == ProgressMode::Rma) {
+        MPI_Win_free(&win);
+    }
+}
+
+bool ProgressChannel::sendInFlight() {
+    int done;
+    MPI_Test(&sendRequest, &done, MPI_STATUS_IGNORE);
+    return !done;
+}
+
+void ProgressChannel::startSend(int progress) {
+    outbox = progress;
+    lastSent = progress;
+    MPI_Start(&sendRequest);
+    sent++;
+}
+
+void ProgressChannel::publish(int progress) {
+    latest = progress;
+    switch (mode) {
+        case ProgressMode::Send:
+            MPI_Send(&progress, 1, MPI_INT, CarRace::REFEREE_RANK,
+                     CarRace::PROGRESS_TAG, MPI_COMM_WORLD);
+            sent++;
+            break;
+        case ProgressMode::Pool:
+            // Coalesce: a step taken while the referee has not caught up is
+            // superseded by the next one
+            if (!sendInFlight()) {
+                startSend(progress);
+            }
+            break;
+        case ProgressMode::Rma:
+            MPI_Win_lock(MPI_LOCK_SHARED, CarRace::REFEREE_RANK, 0, win);
+            MPI_Accumulate(&progress, 1, MPI_INT, CarRace::REFEREE_RANK, rank, 1, MPI_INT,
+                           MPI_REPLACE, win);
+            MPI_Win_unlock(CarRace::REFEREE_RANK, win);
+            sent++;
+            break;
+    }
+}
+
+void ProgressChannel::flush() {
+    if (mode != ProgressMode::Pool) {
+        return;
+    }
+    MPI_Wait(&sendRequest, MPI_STATUS_IGNORE);
+    if (lastSent != latest) {
+        startSend(latest);
+        MPI_Wait(&sendRequest, MPI_STATUS_IGNORE);
+    }
+}
+
+void ProgressChannel::resetPositions() {
+    if (mode == ProgressMode::Rma) {
+        MPI_Win_lock(MPI_LOCK_EXCLUSIVE, rank, 0, win);
+        std::fill(window.begin(), window.end(), 0);
+        MPI_Win_unlock(rank, win);
+    }
+}
+
+long ProgressChannel::poll(std::vector<int>& positions) {
+    long consumed = 0;
+    switch (mode) {
+        case ProgressMode::Send:
+            for (int car = 1; car <= numCars; car++) {
+                int flag;
+                MPI_Iprobe(car, CarRace::PROGRESS_TAG, MPI_COMM_WORLD, &flag, MPI_STATUS_IGNORE);
+                
+                // Drain everything pending so the view is not a frame behind
+                while (flag) {
+                    MPI_Recv(&positions[car], 1, MPI_INT, car, CarRace::PROGRESS_TAG,
+                             MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                    consumed++;
+                    MPI_Iprobe(car, CarRace::PROGRESS_TAG, MPI_COMM_WORLD, &flag, MPI_STATUS_IGNORE);
+                }
+            }
+            break;
+        case ProgressMode::Pool: {
+            std::vector<int> indices(numCars);
+            int completed;
+            MPI_Testsome(numCars, recvRequests.data(), &completed, indices.data(), MPI_STATUSES_IGNORE);
+            for (int i = 0; i < completed; i++) {
+                int car = indices[i] + 1;
+                positions[car] = inbox[car];
+                MPI_Start(&recvRequests[indices[i]]);
+            }
+            consumed = completed > 0 ? completed : 0;
+            break;
+        }
+        case ProgressMode::Rma:
+            // Element-wise atomic read that cannot tear against the cars' updates
+            MPI_Win_lock(MPI_LOCK_SHARED, rank, 0, win);
+            MPI_Get_accumulate(nullptr, 0, MPI_INT, positions.data(), numCars + 1, MPI_INT,
+                               rank, 0, numCars + 1, MPI_INT, MPI_NO_OP, win);
+            MPI_Win_unlock(rank, win);
+            consumed = 1;
+            break;
+    }
+    return consumed;
+}
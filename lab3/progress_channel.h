@@ -0,0 +1,60 @@
+#ifndef PROGRESS_CHANNEL_H
+#define PROGRESS_CHANNEL_H
+
+#include <mpi.h>
+#include <string>
+#include <vector>
+
+enum class ProgressMode {
+    Send, // One MPI_Send per track step, probed by the referee
+    Pool, // Persistent synchronous sends matched by a pool of persistent receives
+    Rma   // Latest position written into a window on the referee
+};
+
+bool parseProgressMode(const std::string& name, ProgressMode& mode);
+const char* progressModeName(ProgressMode mode);
+
+// Carries car positions to the referee. Must be constructed and destroyed
+// by every rank at the same point, since the Rma window is collective.
+//
+// Pool keeps at most one update per car in flight: a car only starts a new
+// MPI_Ssend once the previous one was matched, and otherwise skips the
+// step, so the referee always receives the latest value and never has more
+// than one message per car to drain.
+class ProgressChannel {
+public:
+    ProgressChannel(ProgressMode mode, int numCars, int rank);
+    ~ProgressChannel();
+
+    // Car side, flush() waits until the last published value was delivered
+    void publish(int progress);
+    void flush();
+    long updatesSent() const { return sent; }
+    void resetUpdates() { sent = 0; }
+
+    // Referee side, returns how many updates or window reads were consumed
+    void resetPositions();
+    long poll(std::vector<int>& positions);
+
+private:
+    ProgressMode mode;
+    int numCars;
+    int rank;
+    long sent = 0;
+
+    int outbox = 0;
+    int lastSent = -1;
+    int latest = -1;
+    MPI_Request sendRequest = MPI_REQUEST_NULL;
+
+    std::vector<int> inbox;
+    std::vector<MPI_Request> recvRequests;
+
+    std::vector<int> window;
+    MPI_Win win = MPI_WIN_NULL;
+
+    bool sendInFlight();
+    void startSend(int progress);
+};
+
+#endif // PROGRESS_CHANNEL_H
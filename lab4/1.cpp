@@ -6,7 +6,9 @@
 #include <vector>
 #include <algorithm>
 #include <iomanip>
-#include <chrono>
+#include "distributed_sort.h"
+#include "bench.h"
+#include "topology.h"
 
 using namespace std;
 
@@ -105,11 +107,41 @@ int main(int argc, char **argv) {
     MPI_Init(&argc, &argv);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    // With a mode argument sort generated data of any size; without one, or
+    // with "systolic", run the SIZE-element systolic sorters below.
+    int warmup = 0, reps = 1;
+    if (argc > 1 && string(argv[1]) == "systolic") {
+        if (!parse_bench_args(argc, argv, 2, warmup, reps)) {
+            if (rank == 0) {
+                cout << "Usage: " << argv[0] << " systolic [warmup=W] [reps=R]" << endl;
+            }
+            MPI_Finalize();
+            return 1;
+        }
+    } else if (argc > 1) {
+        string mode(argv[1]);
+        SortOptions options;
+        if ((mode != "sample" && mode != "merge_split") || !parse_sort_options(argc, argv, 2, options)) {
+            if (rank == 0) {
+                cout << "Usage: " << argv[0] << " [systolic | sample|merge_split [keys=N] [dist=uniform|narrow]\n"
+                     << "                     [oversample=S] [seed=N] [warmup=W] [reps=R] [verify=0|1]]" << endl;
+            }
+            MPI_Finalize();
+            return 1;
+        }
+        if (mode == "sample") {
+            sample_sort(rank, size, options);
+        } else {
+            merge_split_sort(rank, size, options);
+        }
+        MPI_Finalize();
+        return 0;
+    }
     
     bool use_dependency_graph = (size > SIZE);
     int input_array[SIZE] = {2, 5, 3, 1, 4};
     int *result = nullptr;
-    auto start_time = chrono::high_resolution_clock::now();
     
     if (rank == 0) {
         print_array("Input array", input_array, SIZE);
@@ -120,37 +152,44 @@ int main(int argc, char **argv) {
         int periods[DIMS_DG] = {0, 0};
         
         MPI_Dims_create(size, DIMS_DG, dims);
-        MPI_Cart_create(MPI_COMM_WORLD, DIMS_DG, dims, periods, 1, &comm);
+        cart_create_local(DIMS_DG, dims, periods, &comm);
         
         if (rank == 0) {
             cout << "Using dependency graph approach with " << dims[0] << "×" << dims[1] << " topology" << endl;
         }
-        
-        result = sort_dependency_graph(input_array, rank, comm);
     } else {
         int dims[DIMS_SFG] = {0};
         int periods[DIMS_SFG] = {0};
         
         MPI_Dims_create(size, DIMS_SFG, dims);
-        MPI_Cart_create(MPI_COMM_WORLD, DIMS_SFG, dims, periods, 1, &comm);
+        cart_create_local(DIMS_SFG, dims, periods, &comm);
         
         if (rank == 0) {
             cout << "Using signal flow graph approach with " << dims[0] << " processes" << endl;
         }
-        
-        result = sort_signal_flow(input_array, rank, comm);
+    }
+    // Grid positions follow the node-major order, so neighbours share a node where they can
+    MPI_Comm_rank(comm, &rank);
+
+    BenchTimer timer(comm, warmup, reps);
+    for (int run = 0; run < timer.runs(); run++) {
+        delete[] result;
+        timer.start();
+        result = use_dependency_graph ? sort_dependency_graph(input_array, rank, comm)
+                                      : sort_signal_flow(input_array, rank, comm);
+        timer.stop();
     }
     
     if (rank == 0) {
-        auto end_time = chrono::high_resolution_clock::now();
-        auto duration = chrono::duration_cast<chrono::microseconds>(end_time - start_time);
-        
         print_array("Sorted array", result, SIZE);
-        cout << "Sorting completed in " << duration.count() << " microseconds" << endl;
+        cout << "Sorting completed in " << static_cast<long>(timer.stats().best * 1e6)
+             << " microseconds (best of " << reps << ")" << endl;
         
         delete[] result;
     }
+    bench_report(comm, "parallel_sort", use_dependency_graph ? "graph" : "cartesian", to_string(SIZE), timer.stats());
     
+    MPI_Comm_free(&comm);
     MPI_Finalize();
     return 0;
 }
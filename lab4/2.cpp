@@ -2,9 +2,12 @@
 #include <iostream>
 #include <iomanip>
 #include <vector>
-#include <chrono>
 #include <random>
 #include <cstring>
+#include <string>
+#include "distributed_gemv.h"
+#include "bench.h"
+#include "topology.h"
 
 #define MATRIX_SIZE 5
 
@@ -20,6 +23,37 @@ int main(int argc, char **argv) {
     MPI_Init(&argc, &argv);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    // Named modes work on block rows for any n and rank count; 0 and 1
+    // select the MATRIX_SIZE-rank element versions below.
+    std::string mode = argc > 1 ? argv[1] : "";
+    if (mode == "ring" || mode == "pipeline" || mode == "stream" || mode == "shared" ||
+        mode == "sparse") {
+        GemvOptions options;
+        if (!parse_gemv_options(argc, argv, 2, options)) {
+            if (rank == 0) {
+                std::cout << "Usage: " << argv[0] << " [0|1 [warmup=W] [reps=R] | ring|pipeline|stream|shared|sparse [n=N]\n"
+                          << "                          [dtype=int32|float|double] [vectors=V] [batch=K] [seed=S]\n"
+                          << "                          [matrix=banded|powerlaw] [band=B] [degree=D] [format=csr|sell]\n"
+                          << "                          [sigma=S] [warmup=W] [reps=R] [verify=0|1]]" << std::endl;
+            }
+            MPI_Finalize();
+            return 1;
+        }
+        if (mode == "ring") {
+            ring_gemv(rank, size, options);
+        } else if (mode == "pipeline") {
+            pipeline_gemv(rank, size, options);
+        } else if (mode == "stream") {
+            stream_gemv(rank, size, options);
+        } else if (mode == "sparse") {
+            sparse_gemv(rank, size, options);
+        } else {
+            shared_gemv(rank, size, options);
+        }
+        MPI_Finalize();
+        return 0;
+    }
     
     int matrix[MATRIX_SIZE * MATRIX_SIZE];
     int vector[MATRIX_SIZE];
@@ -44,39 +78,52 @@ int main(int argc, char **argv) {
     int local_vector[1];
     
     bool use_ring_topology = false;
+    int warmup = 0, reps = 1;
     if (argc > 1) {
         use_ring_topology = (atoi(argv[1]) != 0);
+        if (!parse_bench_args(argc, argv, 2, warmup, reps)) {
+            if (rank == 0) {
+                std::cout << "Usage: " << argv[0] << " 0|1 [warmup=W] [reps=R]" << std::endl;
+            }
+            MPI_Finalize();
+            return 1;
+        }
     }
     
     int dims[1] = {MATRIX_SIZE};
     int periods[1] = {use_ring_topology ? 1 : 0};  // Periodic for ring, non-periodic for pipeline
     
-    MPI_Cart_create(MPI_COMM_WORLD, 1, dims, periods, 1, &comm);
-    
-    auto start_time = std::chrono::high_resolution_clock::now();
-    
-    MPI_Scatter(matrix, MATRIX_SIZE, MPI_INT, local_matrix, MATRIX_SIZE, MPI_INT, 0, MPI_COMM_WORLD);
-    MPI_Scatter(vector, 1, MPI_INT, local_vector, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    cart_create_local(1, dims, periods, &comm);
+    MPI_Comm_rank(comm, &rank); // Ring position, node by node
     
-    if (use_ring_topology) {
-        if (rank == 0) {
-            std::cout << "Using ring topology for matrix-vector multiplication" << std::endl;
-        }
-        ring_multiplication(local_matrix, local_vector, result, rank, comm);
-    } else {
-        if (rank == 0) {
-            std::cout << "Using pipeline topology for matrix-vector multiplication" << std::endl;
+    if (rank == 0) {
+        std::cout << "Using " << (use_ring_topology ? "ring" : "pipeline")
+                  << " topology for matrix-vector multiplication" << std::endl;
+    }
+
+    BenchTimer timer(comm, warmup, reps);
+    for (int run = 0; run < timer.runs(); run++) {
+        timer.start();
+
+        MPI_Scatter(matrix, MATRIX_SIZE, MPI_INT, local_matrix, MATRIX_SIZE, MPI_INT, 0, comm);
+        MPI_Scatter(vector, 1, MPI_INT, local_vector, 1, MPI_INT, 0, comm);
+        
+        if (use_ring_topology) {
+            ring_multiplication(local_matrix, local_vector, result, rank, comm);
+        } else {
+            pipeline_multiplication(local_matrix, local_vector, vector, result, rank, comm);
         }
-        pipeline_multiplication(local_matrix, local_vector, vector, result, rank, comm);
+
+        timer.stop();
     }
     
     if (rank == 0) {
-        auto end_time = std::chrono::high_resolution_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
-        
         print_vector("Result Vector", result, MATRIX_SIZE);
-        std::cout << "Computation completed in " << duration.count() << " microseconds" << std::endl;
+        std::cout << "Computation completed in " << static_cast<long>(timer.stats().best * 1e6)
+                  << " microseconds (best of " << reps << ")" << std::endl;
     }
+    bench_report(comm, "matrix_vector_mult", use_ring_topology ? "ring_element" : "pipeline_element",
+                 std::to_string(MATRIX_SIZE), timer.stats());
     
     MPI_Comm_free(&comm);
     MPI_Finalize();
@@ -137,7 +184,7 @@ void pipeline_multiplication(int* local_matrix, int* local_vector, int* vector,
         
         local_result += local_matrix[i] * vector_elem;
     }
-    MPI_Gather(&local_result, 1, MPI_INT, result, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Gather(&local_result, 1, MPI_INT, result, 1, MPI_INT, 0, comm);
 }
 
 void print_matrix(const char* label, const int* matrix, int rows, int cols) {
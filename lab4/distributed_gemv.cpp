@@ -0,0 +1,773 @@
+#include "distributed_gemv.h"
+#include "gemm_kernel.h"
+#include "bench.h"
+#include "topology.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+static const int VERIFY_SAMPLES = 16;
+
+bool parse_gemv_options(int argc, char** argv, int first, GemvOptions& options) {
+    for (int i = first; i < argc; i++) {
+        string arg(argv[i]);
+        size_t eq = arg.find('=');
+        if (eq == string::npos) {
+            return false;
+        }
+        string key = arg.substr(0, eq);
+        string value = arg.substr(eq + 1);
+
+        if (key == "n") {
+            options.n = atoi(value.c_str());
+        } else if (key == "dtype") {
+            options.dtype = value;
+        } else if (key == "vectors") {
+            options.vectors = atoi(value.c_str());
+        } else if (key == "batch") {
+            options.batch = atoi(value.c_str());
+        } else if (key == "matrix") {
+            options.matrix = value;
+        } else if (key == "band") {
+            options.band = atoi(value.c_str());
+        } else if (key == "degree") {
+            options.degree = atoi(value.c_str());
+        } else if (key == "format") {
+            options.format = value;
+        } else if (key == "sigma") {
+            options.sigma = atoi(value.c_str());
+        } else if (key == "seed") {
+            options.seed = static_cast<unsigned>(strtoul(value.c_str(), nullptr, 10));
+        } else if (key == "warmup") {
+            options.warmup = atoi(value.c_str());
+        } else if (key == "reps") {
+            options.reps = atoi(value.c_str());
+        } else if (key == "verify") {
+            options.verify = atoi(value.c_str()) != 0;
+        } else {
+            return false;
+        }
+    }
+    return options.n > 0 && options.warmup >= 0 && options.reps > 0 && options.vectors > 0 && options.batch > 0 &&
+           options.band >= 0 && options.degree > 0 && options.sigma > 0 &&
+           (options.matrix == "banded" || options.matrix == "powerlaw") &&
+           (options.format == "csr" || options.format == "sell") &&
+           (options.dtype == "int32" || options.dtype == "float" || options.dtype == "double");
+}
+
+struct Range {
+    int start;
+    int size;
+};
+
+static Range block_range(int n, int parts, int index) {
+    int base = n / parts;
+    int extra = n % parts;
+    return {index * base + min(index, extra), base + (index < extra ? 1 : 0)};
+}
+
+static uint64_t coordinate_hash(unsigned seed, long long row, long long col) {
+    uint64_t x = seed * 0x9E3779B97F4A7C15ULL + static_cast<uint64_t>(row) * 0x100000001B3ULL +
+                 static_cast<uint64_t>(col);
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// Elements are 1..10 like the fixed-size version, derived from the global
+// coordinates so every rank fills its own rows.
+static int element_value(unsigned seed, long long row, long long col) {
+    return static_cast<int>(1 + coordinate_hash(seed, row, col) % 10);
+}
+
+template<typename T> MPI_Datatype mpi_type();
+template<> MPI_Datatype mpi_type<int32_t>() { return MPI_INT32_T; }
+template<> MPI_Datatype mpi_type<float>() { return MPI_FLOAT; }
+template<> MPI_Datatype mpi_type<double>() { return MPI_DOUBLE; }
+
+// Checks sampled rows of Y = A * X for the vectors first .. first + count - 1.
+// Y is n x count, row-major; vector v of the stream has x[j] = value(j, v).
+template<typename T>
+static long verify_rows(const vector<T>& Y, int n, int first, int count, unsigned seed_a, unsigned seed_x) {
+    long errors = 0;
+    for (int s = 0; s < VERIFY_SAMPLES; s++) {
+        int i = static_cast<int>(static_cast<long long>(s) * (n - 1) / (VERIFY_SAMPLES - 1));
+        int v = s % count;
+        double expected = 0;
+        for (int j = 0; j < n; j++) {
+            expected += static_cast<double>(element_value(seed_a, i, j)) * element_value(seed_x, j, first + v);
+        }
+        if (static_cast<double>(Y[static_cast<size_t>(i) * count + v]) != expected) {
+            errors++;
+        }
+    }
+    return errors;
+}
+
+template<typename T>
+static void block_gemv(int rank, int size, const GemvOptions& options, bool ring) {
+    const int n = options.n;
+    const unsigned seed_a = options.seed, seed_x = options.seed + 1;
+
+    int dims[1] = {size};
+    int periods[1] = {ring ? 1 : 0};
+    MPI_Comm comm;
+    cart_create_local(1, dims, periods, &comm);
+    MPI_Comm_rank(comm, &rank); // Line position, node by node
+    int left, right;
+    MPI_Cart_shift(comm, 0, 1, &left, &right);
+
+    Range rows = block_range(n, size, rank);
+    vector<T> A(static_cast<size_t>(rows.size) * n);
+    for (int i = 0; i < rows.size; i++) {
+        for (int j = 0; j < n; j++) {
+            A[static_cast<size_t>(i) * n + j] = static_cast<T>(element_value(seed_a, rows.start + i, j));
+        }
+    }
+
+    // Ring: the own x block, padded to the largest block so every shift has
+    // the same count. Pipeline: rank 0 keeps all of x, the others double-
+    // buffer the incoming blocks.
+    const int max_block = (n + size - 1) / size;
+    vector<T> x, buffers[2];
+    if (ring || rank == 0) {
+        Range mine = ring ? rows : Range{0, n};
+        x.assign(ring ? max_block : n, T(0));
+        for (int j = 0; j < mine.size; j++) {
+            x[j] = static_cast<T>(element_value(seed_x, mine.start + j, 0));
+        }
+    } else {
+        buffers[0].resize(max_block);
+        buffers[1].resize(max_block);
+    }
+
+    vector<T> y(rows.size), result;
+    vector<int> counts(size), displs(size);
+    for (int r = 0; r < size; r++) {
+        counts[r] = block_range(n, size, r).size;
+        displs[r] = block_range(n, size, r).start;
+    }
+    if (rank == 0) {
+        result.resize(n);
+    }
+
+    BenchTimer timer(comm, options.warmup, options.reps);
+    for (int run = 0; run < timer.runs(); run++) {
+        fill(y.begin(), y.end(), T(0));
+        if (ring && run > 0) {
+            // A full rotation ends one shift short of home
+            MPI_Sendrecv_replace(x.data(), max_block, mpi_type<T>(), right, 0, left, 0, comm, MPI_STATUS_IGNORE);
+        }
+        timer.start();
+
+        if (ring) {
+            for (int step = 0; step < size; step++) {
+                Range cols = block_range(n, size, (rank - step + size) % size);
+                local_gemv(rows.size, cols.size, &A[cols.start], n, x.data(), y.data());
+                if (step < size - 1) {
+                    MPI_Sendrecv_replace(x.data(), max_block, mpi_type<T>(), right, 0, left, 0,
+                                         comm, MPI_STATUS_IGNORE);
+                }
+            }
+        } else {
+            MPI_Request recv_req = MPI_REQUEST_NULL, send_req = MPI_REQUEST_NULL;
+            if (rank > 0) {
+                MPI_Irecv(buffers[0].data(), block_range(n, size, 0).size, mpi_type<T>(), left, 0, comm, &recv_req);
+            }
+            for (int b = 0; b < size; b++) {
+                Range cols = block_range(n, size, b);
+                T* block = rank == 0 ? &x[cols.start] : buffers[b % 2].data();
+                if (rank > 0) {
+                    MPI_Wait(&recv_req, MPI_STATUS_IGNORE);
+                }
+                // Block b - 1 has left, so its buffer can take block b + 1
+                MPI_Wait(&send_req, MPI_STATUS_IGNORE);
+                if (rank > 0 && b + 1 < size) {
+                    MPI_Irecv(buffers[(b + 1) % 2].data(), block_range(n, size, b + 1).size, mpi_type<T>(),
+                              left, 0, comm, &recv_req);
+                }
+                if (right != MPI_PROC_NULL) {
+                    MPI_Isend(block, cols.size, mpi_type<T>(), right, 0, comm, &send_req);
+                }
+                local_gemv(rows.size, cols.size, &A[cols.start], n, block, y.data());
+            }
+            MPI_Wait(&send_req, MPI_STATUS_IGNORE);
+        }
+
+        MPI_Gatherv(y.data(), rows.size, mpi_type<T>(), result.data(), counts.data(), displs.data(),
+                    mpi_type<T>(), 0, comm);
+
+        timer.stop();
+    }
+    const BenchStats& stats = timer.stats();
+
+    if (rank == 0) {
+        cout << (ring ? "Ring" : "Pipeline") << " y = A * x, n = " << n << ", " << size << " ranks, "
+             << options.dtype << ", " << kernel_isa_name(kernel_isa()) << " kernel" << endl;
+        cout << fixed << setprecision(6)
+             << "Time: best " << stats.best << " s, mean " << stats.mean << " s over " << options.reps
+             << " runs, " << setprecision(2) << 2.0 * n * n / stats.best / 1e9 << " GFLOP/s" << endl;
+        cout << "Messages: " << (ring ? size - 1 : size) << " vector blocks per "
+             << (ring ? "rank" : "link") << ", up to " << max_block << " elements each, one MPI_Gatherv" << endl;
+        if (options.verify) {
+            long errors = verify_rows(result, n, 0, 1, seed_a, seed_x);
+            cout << "Verification: " << (errors == 0 ? "passed" : "FAILED")
+                 << " (" << errors << " wrong sampled entries)" << endl;
+        }
+    }
+    bench_report(comm, "matrix_vector_mult", ring ? "ring" : "pipeline", to_string(n), stats);
+
+    MPI_Comm_free(&comm);
+}
+
+void ring_gemv(int rank, int size, const GemvOptions& options) {
+    if (options.dtype == "int32") {
+        block_gemv<int32_t>(rank, size, options, true);
+    } else if (options.dtype == "float") {
+        block_gemv<float>(rank, size, options, true);
+    } else {
+        block_gemv<double>(rank, size, options, true);
+    }
+}
+
+void pipeline_gemv(int rank, int size, const GemvOptions& options) {
+    if (options.dtype == "int32") {
+        block_gemv<int32_t>(rank, size, options, false);
+    } else if (options.dtype == "float") {
+        block_gemv<float>(rank, size, options, false);
+    } else {
+        block_gemv<double>(rank, size, options, false);
+    }
+}
+
+template<typename T>
+static void stream_ring(int rank, int size, const GemvOptions& options) {
+    const int n = options.n;
+    const unsigned seed_a = options.seed, seed_x = options.seed + 1;
+
+    int dims[1] = {size};
+    int periods[1] = {1};
+    MPI_Comm comm;
+    cart_create_local(1, dims, periods, &comm);
+    MPI_Comm_rank(comm, &rank); // Line position, node by node
+    int left, right;
+    MPI_Cart_shift(comm, 0, 1, &left, &right);
+
+    Range rows = block_range(n, size, rank);
+    vector<T> A(static_cast<size_t>(rows.size) * n);
+    for (int i = 0; i < rows.size; i++) {
+        for (int j = 0; j < n; j++) {
+            A[static_cast<size_t>(i) * n + j] = static_cast<T>(element_value(seed_a, rows.start + i, j));
+        }
+    }
+
+    // Panels are row-major block x batch, so a block of rows of the n x batch
+    // batch is contiguous for both MPI_Scatterv and MPI_Gatherv.
+    const int batch = min(options.batch, options.vectors);
+    const int max_block = (n + size - 1) / size;
+    vector<T> panel(static_cast<size_t>(max_block) * batch);
+    vector<T> Y(static_cast<size_t>(rows.size) * batch);
+    vector<T> X, result;
+    if (rank == 0) {
+        X.resize(static_cast<size_t>(n) * batch);
+        result.resize(static_cast<size_t>(n) * batch);
+    }
+
+    vector<int> counts(size), displs(size);
+    long errors = 0;
+    BenchTimer timer(comm, options.warmup, options.reps);
+    for (int run = 0; run < timer.runs(); run++) {
+        timer.start();
+
+        for (int first = 0; first < options.vectors; first += batch) {
+            int count = min(batch, options.vectors - first);
+            for (int r = 0; r < size; r++) {
+                counts[r] = block_range(n, size, r).size * count;
+                displs[r] = block_range(n, size, r).start * count;
+            }
+            if (rank == 0) {
+                for (int j = 0; j < n; j++) {
+                    for (int v = 0; v < count; v++) {
+                        X[static_cast<size_t>(j) * count + v] = static_cast<T>(element_value(seed_x, j, first + v));
+                    }
+                }
+            }
+            MPI_Scatterv(X.data(), counts.data(), displs.data(), mpi_type<T>(),
+                         panel.data(), rows.size * count, mpi_type<T>(), 0, comm);
+
+            fill(Y.begin(), Y.end(), T(0));
+            for (int step = 0; step < size; step++) {
+                Range cols = block_range(n, size, (rank - step + size) % size);
+                if (count == 1) {
+                    local_gemv(rows.size, cols.size, &A[cols.start], n, panel.data(), Y.data());
+                } else {
+                    local_gemm(rows.size, count, cols.size, &A[cols.start], n, panel.data(), count,
+                               Y.data(), count);
+                }
+                if (step < size - 1) {
+                    MPI_Sendrecv_replace(panel.data(), max_block * count, mpi_type<T>(), right, 0, left, 0,
+                                         comm, MPI_STATUS_IGNORE);
+                }
+            }
+
+            MPI_Gatherv(Y.data(), rows.size * count, mpi_type<T>(), result.data(), counts.data(),
+                        displs.data(), mpi_type<T>(), 0, comm);
+            // Spot-check the first and the last batch of the first pass
+            bool last = first + batch >= options.vectors;
+            if (rank == 0 && options.verify && run == 0 && (first == 0 || last)) {
+                errors += verify_rows(result, n, first, count, seed_a, seed_x);
+            }
+        }
+
+        timer.stop();
+    }
+    const BenchStats& stats = timer.stats();
+
+    if (rank == 0) {
+        int batches = (options.vectors + batch - 1) / batch;
+        cout << "Stream y = A * x, n = " << n << ", " << options.vectors << " vectors in batches of " << batch
+             << ", " << size << " ranks, " << options.dtype << ", " << kernel_isa_name(kernel_isa())
+             << " kernel" << endl;
+        cout << fixed << setprecision(6)
+             << "Time: best " << stats.best << " s, mean " << stats.mean << " s over " << options.reps
+             << " runs, " << setprecision(1) << options.vectors / stats.best << " vectors/s, " << setprecision(2)
+             << 2.0 * n * n * options.vectors / stats.best / 1e9 << " GFLOP/s" << endl;
+        cout << "Messages: " << batches * (size - 1) << " ring shifts per rank, up to "
+             << max_block * batch << " elements each" << endl;
+        if (options.verify) {
+            cout << "Verification: " << (errors == 0 ? "passed" : "FAILED")
+                 << " (" << errors << " wrong sampled entries)" << endl;
+        }
+    }
+    bench_report(comm, "matrix_vector_mult", "stream", to_string(n) + "x" + to_string(options.vectors), stats);
+
+    MPI_Comm_free(&comm);
+}
+
+void stream_gemv(int rank, int size, const GemvOptions& options) {
+    if (options.dtype == "int32") {
+        stream_ring<int32_t>(rank, size, options);
+    } else if (options.dtype == "float") {
+        stream_ring<float>(rank, size, options);
+    } else {
+        stream_ring<double>(rank, size, options);
+    }
+}
+
+// x and the node's part of y live once per node in a NodeBuffer. Rows of A
+// follow the node-major rank order; every rank multiplies its rows against
+// x in place and writes its part of y in place. Only the node leaders
+// communicate: x is broadcast and y gathered over the leader communicator.
+template<typename T>
+static void node_shared_gemv(int rank, int size, const GemvOptions& options) {
+    const int n = options.n;
+    const unsigned seed_a = options.seed, seed_x = options.seed + 1;
+    const NodeTopology& topology = node_topology();
+    const bool leader = topology.node_rank == 0;
+
+    int first = topology.local_rank - topology.node_rank;
+    Range rows = block_range(n, size, topology.local_rank);
+    Range last_rows = block_range(n, size, first + topology.node_size - 1);
+    Range node_rows{block_range(n, size, first).start, 0};
+    node_rows.size = last_rows.start + last_rows.size - node_rows.start;
+
+    vector<T> A(static_cast<size_t>(rows.size) * n);
+    for (int i = 0; i < rows.size; i++) {
+        for (int j = 0; j < n; j++) {
+            A[static_cast<size_t>(i) * n + j] = static_cast<T>(element_value(seed_a, rows.start + i, j));
+        }
+    }
+
+    NodeBuffer shared((static_cast<size_t>(n) + node_rows.size) * sizeof(T));
+    T* x = shared.as<T>();
+    T* node_y = x + n;
+    T* y = node_y + (rows.start - node_rows.start);
+    if (rank == 0) {
+        for (int j = 0; j < n; j++) {
+            x[j] = static_cast<T>(element_value(seed_x, j, 0));
+        }
+    }
+
+    vector<T> result;
+    vector<int> counts, displs;
+    if (leader) {
+        int mine[2] = {node_rows.start, node_rows.size};
+        vector<int> all(2 * topology.nodes);
+        MPI_Allgather(mine, 2, MPI_INT, all.data(), 2, MPI_INT, topology.leaders);
+        for (int node = 0; node < topology.nodes; node++) {
+            displs.push_back(all[2 * node]);
+            counts.push_back(all[2 * node + 1]);
+        }
+    }
+    if (rank == 0) {
+        result.resize(n);
+    }
+    shared.sync();
+
+    BenchTimer timer(MPI_COMM_WORLD, options.warmup, options.reps);
+    for (int run = 0; run < timer.runs(); run++) {
+        timer.start();
+        if (leader) {
+            MPI_Bcast(x, n, mpi_type<T>(), 0, topology.leaders);
+        }
+        // Cleared after the start barrier: until then the leader may still
+        // be gathering the previous run's y
+        fill(y, y + rows.size, T(0));
+        shared.sync();
+
+        local_gemv(rows.size, n, A.data(), n, x, y);
+
+        shared.sync();
+        if (leader) {
+            MPI_Gatherv(node_y, node_rows.size, mpi_type<T>(), result.data(), counts.data(), displs.data(),
+                        mpi_type<T>(), 0, topology.leaders);
+        }
+        timer.stop();
+    }
+    const BenchStats& stats = timer.stats();
+
+    if (rank == 0) {
+        cout << "Shared y = A * x, n = " << n << ", " << size << " ranks on " << topology.nodes << " node(s), "
+             << options.dtype << ", " << kernel_isa_name(kernel_isa()) << " kernel" << endl;
+        cout << fixed << setprecision(6)
+             << "Time: best " << stats.best << " s, mean " << stats.mean << " s over " << options.reps
+             << " runs, " << setprecision(2) << 2.0 * n * n / stats.best / 1e9 << " GFLOP/s" << endl;
+        cout << "Messages: one MPI_Bcast of x and one MPI_Gatherv of y among " << topology.nodes
+             << " node leaders; x is held once per node" << endl;
+        if (options.verify) {
+            long errors = verify_rows(result, n, 0, 1, seed_a, seed_x);
+            cout << "Verification: " << (errors == 0 ? "passed" : "FAILED")
+                 << " (" << errors << " wrong sampled entries)" << endl;
+        }
+    }
+    bench_report(MPI_COMM_WORLD, "matrix_vector_mult", "shared", to_string(n), stats);
+}
+
+void shared_gemv(int rank, int size, const GemvOptions& options) {
+    if (options.dtype == "int32") {
+        node_shared_gemv<int32_t>(rank, size, options);
+    } else if (options.dtype == "float") {
+        node_shared_gemv<float>(rank, size, options);
+    } else {
+        node_shared_gemv<double>(rank, size, options);
+    }
+}
+
+static const int SELL_C = 8;           // Rows per SELL chunk
+static const double POWER_LAW_GAMMA = 2.5;
+
+// Sorted global columns of row i. Banded rows cover the diagonal and band
+// columns either side. Power-law rows have a Pareto-distributed length
+// around the mean degree, capped at 64 times it, and draw columns with a
+// density falling as col^(-2/3), so the lowest columns are hubs that most
+// rows touch. Both always include the diagonal.
+static void sparse_row(const GemvOptions& options, long long i, vector<int>& cols) {
+    const int n = options.n;
+    cols.clear();
+    if (options.matrix == "banded") {
+        for (long long j = max(0LL, i - options.band); j <= min<long long>(n - 1, i + options.band); j++) {
+            cols.push_back(static_cast<int>(j));
+        }
+        return;
+    }
+
+    auto uniform = [&](long long k) {
+        return (coordinate_hash(options.seed + 2, i, k) >> 11) * (1.0 / 9007199254740992.0);
+    };
+    double shortest = options.degree * (POWER_LAW_GAMMA - 2) / (POWER_LAW_GAMMA - 1);
+    double length = shortest / pow(1 - uniform(-1), 1 / (POWER_LAW_GAMMA - 1));
+    int entries = static_cast<int>(min<double>({length, 64.0 * options.degree, static_cast<double>(n)}));
+    cols.push_back(static_cast<int>(i));
+    for (int k = 1; k < entries; k++) {
+        cols.push_back(static_cast<int>(min<double>(n - 1, n * pow(uniform(k), 3))));
+    }
+    sort(cols.begin(), cols.end());
+    cols.erase(unique(cols.begin(), cols.end()), cols.end());
+}
+
+// Rows in CSR form; column indices point into the x the block is multiplied by
+template<typename T>
+struct CsrBlock {
+    vector<int> row_start{0};
+    vector<int> cols;
+    vector<T> values;
+
+    int rows() const { return static_cast<int>(row_start.size()) - 1; }
+};
+
+// SELL-C-sigma: rows sorted by length within windows of sigma rows and cut
+// into chunks of SELL_C rows, each stored column by column and padded to
+// its longest row, so the rows of a chunk advance in lockstep.
+template<typename T>
+struct SellBlock {
+    vector<int> order;       // Row of each chunk lane
+    vector<int> chunk_start;
+    vector<int> chunk_width;
+    vector<int> cols;
+    vector<T> values;
+    long long padding = 0;
+};
+
+template<typename T>
+static SellBlock<T> sell_from_csr(const CsrBlock<T>& csr, int sigma) {
+    const int rows = csr.rows();
+    auto length = [&](int i) { return csr.row_start[i + 1] - csr.row_start[i]; };
+    SellBlock<T> sell;
+    sell.order.resize(rows);
+    for (int i = 0; i < rows; i++) {
+        sell.order[i] = i;
+    }
+    for (int first = 0; first < rows; first += sigma) {
+        stable_sort(sell.order.begin() + first, sell.order.begin() + min(rows, first + sigma),
+                    [&](int a, int b) { return length(a) > length(b); });
+    }
+
+    for (int first = 0; first < rows; first += SELL_C) {
+        int width = 0;
+        for (int lane = 0; lane < SELL_C && first + lane < rows; lane++) {
+            width = max(width, length(sell.order[first + lane]));
+        }
+        sell.chunk_start.push_back(static_cast<int>(sell.cols.size()));
+        sell.chunk_width.push_back(width);
+        // Padding multiplies a zero by x[0], which exists whenever width > 0
+        sell.cols.resize(sell.cols.size() + static_cast<size_t>(width) * SELL_C, 0);
+        sell.values.resize(sell.cols.size(), T(0));
+        for (int lane = 0; lane < SELL_C && first + lane < rows; lane++) {
+            int row = sell.order[first + lane];
+            for (int k = 0; k < length(row); k++) {
+                size_t slot = sell.chunk_start.back() + static_cast<size_t>(k) * SELL_C + lane;
+                sell.cols[slot] = csr.cols[csr.row_start[row] + k];
+                sell.values[slot] = csr.values[csr.row_start[row] + k];
+            }
+        }
+    }
+    sell.padding = static_cast<long long>(sell.cols.size()) - static_cast<long long>(csr.cols.size());
+    return sell;
+}
+
+// y += A * x
+template<typename T>
+static void csr_multiply(const CsrBlock<T>& A, const T* x, T* y) {
+    for (int i = 0; i < A.rows(); i++) {
+        T sum = 0;
+        for (int p = A.row_start[i]; p < A.row_start[i + 1]; p++) {
+            sum += A.values[p] * x[A.cols[p]];
+        }
+        y[i] += sum;
+    }
+}
+
+template<typename T>
+static void sell_multiply(const SellBlock<T>& A, const T* x, T* y) {
+    const int rows = static_cast<int>(A.order.size());
+    for (size_t chunk = 0; chunk < A.chunk_start.size(); chunk++) {
+        T sum[SELL_C] = {};
+        const int* cols = &A.cols[A.chunk_start[chunk]];
+        const T* values = &A.values[A.chunk_start[chunk]];
+        for (int k = 0; k < A.chunk_width[chunk]; k++) {
+            for (int lane = 0; lane < SELL_C; lane++) {
+                sum[lane] += values[k * SELL_C + lane] * x[cols[k * SELL_C + lane]];
+            }
+        }
+        int first = static_cast<int>(chunk) * SELL_C;
+        for (int lane = 0; lane < SELL_C && first + lane < rows; lane++) {
+            y[A.order[first + lane]] += sum[lane];
+        }
+    }
+}
+
+// Rows are split by where their columns live: the own block of x, indexed
+// from its start, and the halo, indexed in the order it is received.
+// Halo entries come sorted by global column, which groups them by owner.
+template<typename T>
+static void sparse_halo_gemv(int rank, int size, const GemvOptions& options) {
+    const int n = options.n;
+    const unsigned seed_a = options.seed, seed_x = options.seed + 1;
+    const bool sell = options.format == "sell";
+    MPI_Comm comm = node_topology().local; // Neighbouring blocks share a node where they can
+    MPI_Comm_rank(comm, &rank);
+
+    Range rows = block_range(n, size, rank);
+    const int own_end = rows.start + rows.size;
+    vector<vector<int>> row_cols(rows.size);
+    vector<int> halo_cols;
+    for (int i = 0; i < rows.size; i++) {
+        sparse_row(options, rows.start + i, row_cols[i]);
+        for (int col : row_cols[i]) {
+            if (col < rows.start || col >= own_end) {
+                halo_cols.push_back(col);
+            }
+        }
+    }
+    sort(halo_cols.begin(), halo_cols.end());
+    halo_cols.erase(unique(halo_cols.begin(), halo_cols.end()), halo_cols.end());
+
+    CsrBlock<T> own, halo;
+    for (int i = 0; i < rows.size; i++) {
+        for (int col : row_cols[i]) {
+            T value = static_cast<T>(element_value(seed_a, rows.start + i, col));
+            if (col >= rows.start && col < own_end) {
+                own.cols.push_back(col - rows.start);
+                own.values.push_back(value);
+            } else {
+                halo.cols.push_back(static_cast<int>(lower_bound(halo_cols.begin(), halo_cols.end(), col) -
+                                                     halo_cols.begin()));
+                halo.values.push_back(value);
+            }
+        }
+        own.row_start.push_back(static_cast<int>(own.cols.size()));
+        halo.row_start.push_back(static_cast<int>(halo.cols.size()));
+    }
+    row_cols.clear();
+    row_cols.shrink_to_fit();
+    SellBlock<T> own_sell, halo_sell;
+    if (sell) {
+        own_sell = sell_from_csr(own, options.sigma);
+        halo_sell = sell_from_csr(halo, options.sigma);
+    }
+
+    // Halo pattern: how many entries this rank needs from each owner, then
+    // which ones, so each owner learns what to send where
+    vector<int> recv_counts(size, 0), recv_displs(size, 0), send_counts(size), send_displs(size, 0);
+    int owner = 0;
+    for (int col : halo_cols) {
+        while (col >= block_range(n, size, owner).start + block_range(n, size, owner).size) {
+            owner++;
+        }
+        recv_counts[owner]++;
+    }
+    MPI_Alltoall(recv_counts.data(), 1, MPI_INT, send_counts.data(), 1, MPI_INT, comm);
+    for (int r = 1; r < size; r++) {
+        recv_displs[r] = recv_displs[r - 1] + recv_counts[r - 1];
+        send_displs[r] = send_displs[r - 1] + send_counts[r - 1];
+    }
+    vector<int> send_index(send_displs[size - 1] + send_counts[size - 1]);
+    MPI_Alltoallv(halo_cols.data(), recv_counts.data(), recv_displs.data(), MPI_INT, send_index.data(),
+                  send_counts.data(), send_displs.data(), MPI_INT, comm);
+    for (int& col : send_index) {
+        col -= rows.start;
+    }
+    vector<int> sources, targets;
+    for (int r = 0; r < size; r++) {
+        if (recv_counts[r] > 0) {
+            sources.push_back(r);
+        }
+        if (send_counts[r] > 0) {
+            targets.push_back(r);
+        }
+    }
+
+    vector<T> x(rows.size), x_halo(halo_cols.size()), send_buffer(send_index.size()), y(rows.size);
+    for (int j = 0; j < rows.size; j++) {
+        x[j] = static_cast<T>(element_value(seed_x, rows.start + j, 0));
+    }
+    vector<MPI_Request> requests(sources.size() + targets.size());
+
+    BenchTimer timer(comm, options.warmup, options.reps);
+    for (int run = 0; run < timer.runs(); run++) {
+        timer.start();
+
+        for (size_t s = 0; s < sources.size(); s++) {
+            int r = sources[s];
+            MPI_Irecv(&x_halo[recv_displs[r]], recv_counts[r], mpi_type<T>(), r, 0, comm, &requests[s]);
+        }
+        for (size_t p = 0; p < send_index.size(); p++) {
+            send_buffer[p] = x[send_index[p]];
+        }
+        for (size_t t = 0; t < targets.size(); t++) {
+            int r = targets[t];
+            MPI_Isend(&send_buffer[send_displs[r]], send_counts[r], mpi_type<T>(), r, 0, comm,
+                      &requests[sources.size() + t]);
+        }
+
+        fill(y.begin(), y.end(), T(0));
+        if (sell) {
+            sell_multiply(own_sell, x.data(), y.data());
+        } else {
+            csr_multiply(own, x.data(), y.data());
+        }
+        MPI_Waitall(static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+        if (sell) {
+            sell_multiply(halo_sell, x_halo.data(), y.data());
+        } else {
+            csr_multiply(halo, x_halo.data(), y.data());
+        }
+
+        timer.stop();
+    }
+    const BenchStats& stats = timer.stats();
+
+    // Spread samples over the rank's rows and recompute them from scratch
+    long errors = 0;
+    if (options.verify) {
+        vector<int> cols;
+        int samples = min(rows.size, VERIFY_SAMPLES);
+        for (int s = 0; s < samples; s++) {
+            int i = samples == 1 ? 0 : static_cast<int>(static_cast<long long>(s) * (rows.size - 1) / (samples - 1));
+            sparse_row(options, rows.start + i, cols);
+            double expected = 0;
+            for (int col : cols) {
+                expected += static_cast<double>(element_value(seed_a, rows.start + i, col)) *
+                            element_value(seed_x, col, 0);
+            }
+            if (static_cast<double>(y[i]) != expected) {
+                errors++;
+            }
+        }
+        MPI_Allreduce(MPI_IN_PLACE, &errors, 1, MPI_LONG, MPI_SUM, comm);
+    }
+
+    // nnz, halo entries, messages and SELL padding summed; nnz and halo maxima
+    long long local[4] = {static_cast<long long>(own.cols.size() + halo.cols.size()),
+                          static_cast<long long>(halo_cols.size()), static_cast<long long>(sources.size()),
+                          own_sell.padding + halo_sell.padding};
+    long long total[4], largest[2];
+    MPI_Reduce(local, total, 4, MPI_LONG_LONG, MPI_SUM, 0, comm);
+    MPI_Reduce(local, largest, 2, MPI_LONG_LONG, MPI_MAX, 0, comm);
+    if (rank == 0) {
+        const double kib = 1024.0;
+        const int max_block = (n + size - 1) / size;
+        cout << "Sparse y = A * x, " << options.matrix << " n = " << n << ", " << total[0] << " nonzeros ("
+             << fixed << setprecision(1) << static_cast<double>(total[0]) / n << " per row), "
+             << options.format;
+        if (sell) {
+            cout << "-" << SELL_C << "-" << options.sigma;
+        }
+        cout << ", " << size << " ranks, " << options.dtype << endl;
+        cout << setprecision(6)
+             << "Time: best " << stats.best << " s, mean " << stats.mean << " s over " << options.reps
+             << " runs, " << setprecision(2) << 2.0 * total[0] / stats.best / 1e9 << " GFLOP/s" << endl;
+        cout << setprecision(1) << "Halo: " << total[1] * sizeof(T) / kib << " KiB in " << total[2]
+             << " messages per multiply, at most " << largest[1] * sizeof(T) / kib
+             << " KiB into one rank; a ring rotation of x moves "
+             << static_cast<double>(size) * (size - 1) * max_block * sizeof(T) / kib << " KiB" << endl;
+        cout << setprecision(2) << "Balance: nonzeros per rank max/mean "
+             << largest[0] / (static_cast<double>(total[0]) / size);
+        if (sell) {
+            cout << ", SELL padding " << 100.0 * total[3] / total[0] << "%";
+        }
+        cout << endl;
+        if (options.verify) {
+            cout << "Verification: " << (errors == 0 ? "passed" : "FAILED")
+                 << " (" << errors << " wrong sampled entries)" << endl;
+        }
+    }
+    bench_report(comm, "matrix_vector_mult", "sparse_" + options.matrix + "_" + options.format, to_string(n),
+                 stats);
+}
+
+void sparse_gemv(int rank, int size, const GemvOptions& options) {
+    if (options.dtype == "int32") {
+        sparse_halo_gemv<int32_t>(rank, size, options);
+    } else if (options.dtype == "float") {
+        sparse_halo_gemv<float>(rank, size, options);
+    } else {
+        sparse_halo_gemv<double>(rank, size, options);
+    }
+}
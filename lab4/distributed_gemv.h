@@ -0,0 +1,51 @@
+#ifndef DISTRIBUTED_GEMV_H
+#define DISTRIBUTED_GEMV_H
+
+#include <mpi.h>
+#include <string>
+
+// Options of the block-row matrix-vector modes, given as key=value
+// arguments after the mode name, e.g. "ring n=20000 dtype=float".
+struct GemvOptions {
+    int n = 8192;
+    std::string dtype = "int32"; // int32, float or double
+    int vectors = 256;  // Stream mode: vectors multiplied by the resident A
+    int batch = 16;     // Stream mode: vectors carried by one ring shift
+    std::string matrix = "banded"; // Sparse mode: banded or powerlaw
+    int band = 8;       // Sparse banded: nonzeros up to band columns either side of the diagonal
+    int degree = 16;    // Sparse power-law: mean nonzeros per row
+    std::string format = "csr"; // Sparse mode: csr or sell (SELL-C-sigma)
+    int sigma = 256;    // Sparse sell: rows sorted by length within windows of sigma rows
+    unsigned seed = 1;
+    int warmup = 0;     // Untimed runs before the timed ones
+    int reps = 3;
+    bool verify = true;
+};
+
+bool parse_gemv_options(int argc, char** argv, int first, GemvOptions& options);
+
+// Rank r owns the r-th block of rows of A and the r-th block of x. The
+// vector blocks travel around a periodic 1D Cartesian ring with
+// MPI_Sendrecv_replace; after size steps every rank has used every block.
+void ring_gemv(int rank, int size, const GemvOptions& options);
+
+// Non-periodic line: rank 0 holds x and feeds it block by block down the
+// pipeline, every rank multiplying each block as it passes through.
+void pipeline_gemv(int rank, int size, const GemvOptions& options);
+
+// Ring with A resident across a stream of vectors. Rank 0 scatters each
+// batch of vectors as an n x batch panel, every ring shift carries a
+// block of that panel, and the local products become GEMMs.
+void stream_gemv(int rank, int size, const GemvOptions& options);
+
+// Sparse A in CSR or SELL-C-sigma form, distributed by blocks of rows
+// like the dense modes. Each rank receives only the entries of x its
+// columns refer to, from the ranks that own them, through a halo pattern
+// built once; the own-block part is multiplied while they arrive.
+void sparse_gemv(int rank, int size, const GemvOptions& options);
+
+// x and y are held once per node in shared memory. Each rank multiplies
+// its rows in place; only node leaders broadcast x and gather y.
+void shared_gemv(int rank, int size, const GemvOptions& options);
+
+#endif // DISTRIBUTED_GEMV_H
@@ -0,0 +1,362 @@
+#include "distributed_sort.h"
+#include "bench.h"
+#include "topology.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+using namespace std;
+
+bool parse_sort_options(int argc, char** argv, int first, SortOptions& options) {
+    for (int i = first; i < argc; i++) {
+        string arg(argv[i]);
+        size_t eq = arg.find('=');
+        if (eq == string::npos) {
+            return false;
+        }
+        string key = arg.substr(0, eq);
+        string value = arg.substr(eq + 1);
+
+        if (key == "keys") {
+            options.keys = atoll(value.c_str());
+        } else if (key == "dist") {
+            options.dist = value;
+        } else if (key == "oversample") {
+            options.oversample = atoi(value.c_str());
+        } else if (key == "seed") {
+            options.seed = static_cast<unsigned>(strtoul(value.c_str(), nullptr, 10));
+        } else if (key == "warmup") {
+            options.warmup = atoi(value.c_str());
+        } else if (key == "reps") {
+            options.reps = atoi(value.c_str());
+        } else if (key == "verify") {
+            options.verify = atoi(value.c_str()) != 0;
+        } else {
+            return false;
+        }
+    }
+    return options.keys > 0 && options.oversample > 0 && options.warmup >= 0 && options.reps > 0 &&
+           (options.dist == "uniform" || options.dist == "narrow");
+}
+
+static long long share_start(long long n, int parts, int index) {
+    return index * (n / parts) + min<long long>(index, n % parts);
+}
+
+void generate_keys(vector<int32_t>& keys, const SortOptions& options, int rank, int size) {
+    long long start = share_start(options.keys, size, rank);
+    long long end = share_start(options.keys, size, rank + 1);
+    keys.resize(end - start);
+    for (long long i = start; i < end; i++) {
+        // splitmix64 of the global index
+        uint64_t x = options.seed * 0x9E3779B97F4A7C15ULL + static_cast<uint64_t>(i);
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        x ^= x >> 31;
+        keys[i - start] = options.dist == "narrow" ? static_cast<int32_t>(x % 1000)
+                                                   : static_cast<int32_t>(static_cast<uint32_t>(x));
+    }
+}
+
+void radix_sort(vector<int32_t>& keys, vector<int32_t>& scratch) {
+    const int PASSES = 4;
+    const int BUCKETS = 256;
+    size_t n = keys.size();
+    scratch.resize(n);
+
+    // Flipping the sign bit makes signed order equal to unsigned digit order
+    auto digit = [](int32_t key, int pass) {
+        return ((static_cast<uint32_t>(key) ^ 0x80000000u) >> (8 * pass)) & 0xFF;
+    };
+
+    // All four histograms in one read of the input
+    vector<size_t> counts(PASSES * BUCKETS, 0);
+    for (size_t i = 0; i < n; i++) {
+        uint32_t key = static_cast<uint32_t>(keys[i]) ^ 0x80000000u;
+        counts[0 * BUCKETS + (key & 0xFF)]++;
+        counts[1 * BUCKETS + ((key >> 8) & 0xFF)]++;
+        counts[2 * BUCKETS + ((key >> 16) & 0xFF)]++;
+        counts[3 * BUCKETS + (key >> 24)]++;
+    }
+
+    int32_t* src = keys.data();
+    int32_t* dst = scratch.data();
+    for (int pass = 0; pass < PASSES; pass++) {
+        size_t* count = &counts[pass * BUCKETS];
+        if (n == 0 || count[digit(src[0], pass)] == n) {
+            continue;
+        }
+        size_t offset = 0;
+        for (int b = 0; b < BUCKETS; b++) {
+            size_t c = count[b];
+            count[b] = offset;
+            offset += c;
+        }
+        for (size_t i = 0; i < n; i++) {
+            dst[count[digit(src[i], pass)]++] = src[i];
+        }
+        swap(src, dst);
+    }
+    if (src != keys.data()) {
+        keys.swap(scratch);
+    }
+}
+
+// Global order check: every rank is sorted, each rank's first key is not
+// below the previous rank's last key, and the key count and sum survived.
+static bool check_sorted(const vector<int32_t>& keys, long long expected_count,
+                         uint64_t expected_sum, int rank, int size, MPI_Comm comm) {
+    int ok = is_sorted(keys.begin(), keys.end()) ? 1 : 0;
+
+    // Empty ranks pass their predecessor's boundary through
+    int32_t last = INT32_MIN;
+    for (int r = 0; r < size - 1; r++) {
+        if (rank == r) {
+            if (!keys.empty()) {
+                last = keys.back();
+            }
+            MPI_Send(&last, 1, MPI_INT32_T, r + 1, 0, comm);
+        } else if (rank == r + 1) {
+            MPI_Recv(&last, 1, MPI_INT32_T, r, 0, comm, MPI_STATUS_IGNORE);
+            if (!keys.empty() && keys.front() < last) {
+                ok = 0;
+            }
+        }
+    }
+
+    long long count = static_cast<long long>(keys.size());
+    uint64_t sum = 0;
+    for (int32_t key : keys) {
+        sum += static_cast<uint32_t>(key);
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_MIN, comm);
+    MPI_Allreduce(MPI_IN_PLACE, &count, 1, MPI_LONG_LONG, MPI_SUM, comm);
+    MPI_Allreduce(MPI_IN_PLACE, &sum, 1, MPI_UINT64_T, MPI_SUM, comm);
+    return ok == 1 && count == expected_count && sum == expected_sum;
+}
+
+// Sample sort with regular sampling: sort locally, take oversample evenly
+// spaced keys per rank, gather them everywhere and pick size - 1 splitters.
+// One MPI_Alltoallv then sends every key to the rank owning its range, and
+// the received runs are sorted again locally.
+void sample_sort(int rank, int size, const SortOptions& options) {
+    vector<int32_t> input, keys, scratch, received;
+    generate_keys(input, options, rank, size);
+
+    uint64_t input_sum = 0;
+    for (int32_t key : input) {
+        input_sum += static_cast<uint32_t>(key);
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &input_sum, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+
+    vector<int32_t> samples(options.oversample), all_samples(static_cast<size_t>(options.oversample) * size);
+    vector<int32_t> splitters(size - 1);
+    vector<int> send_counts(size), send_displs(size), recv_counts(size), recv_displs(size);
+
+    // Phase timings of the best run: local sort, splitters, exchange, final sort
+    double best_phases[4] = {0, 0, 0, 0};
+    long long max_keys = 0;
+    bool sorted = true;
+
+    BenchTimer timer(MPI_COMM_WORLD, options.warmup, options.reps);
+    for (int run = 0; run < timer.runs(); run++) {
+        keys = input;
+        double phases[4];
+        timer.start();
+        double start = MPI_Wtime();
+
+        radix_sort(keys, scratch);
+        double t1 = MPI_Wtime();
+        phases[0] = t1 - start;
+
+        // Empty ranks contribute INT32_MAX samples, which only push splitters up
+        for (int s = 0; s < options.oversample; s++) {
+            samples[s] = keys.empty() ? INT32_MAX
+                                      : keys[(keys.size() * (2 * s + 1)) / (2 * options.oversample)];
+        }
+        MPI_Allgather(samples.data(), options.oversample, MPI_INT32_T,
+                      all_samples.data(), options.oversample, MPI_INT32_T, MPI_COMM_WORLD);
+        sort(all_samples.begin(), all_samples.end());
+        for (int r = 1; r < size; r++) {
+            splitters[r - 1] = all_samples[static_cast<size_t>(r) * options.oversample];
+        }
+
+        // Rank r gets the keys in [splitters[r - 1], splitters[r])
+        size_t from = 0;
+        for (int r = 0; r < size; r++) {
+            size_t to = r == size - 1 ? keys.size()
+                                      : lower_bound(keys.begin() + from, keys.end(), splitters[r]) - keys.begin();
+            send_counts[r] = static_cast<int>(to - from);
+            send_displs[r] = static_cast<int>(from);
+            from = to;
+        }
+        double t2 = MPI_Wtime();
+        phases[1] = t2 - t1;
+
+        MPI_Alltoall(send_counts.data(), 1, MPI_INT, recv_counts.data(), 1, MPI_INT, MPI_COMM_WORLD);
+        int incoming = 0;
+        for (int r = 0; r < size; r++) {
+            recv_displs[r] = incoming;
+            incoming += recv_counts[r];
+        }
+        received.resize(incoming);
+        MPI_Alltoallv(keys.data(), send_counts.data(), send_displs.data(), MPI_INT32_T,
+                      received.data(), recv_counts.data(), recv_displs.data(), MPI_INT32_T, MPI_COMM_WORLD);
+        double t3 = MPI_Wtime();
+        phases[2] = t3 - t2;
+
+        radix_sort(received, scratch);
+        phases[3] = MPI_Wtime() - t3;
+
+        timer.stop();
+        MPI_Allreduce(MPI_IN_PLACE, phases, 4, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+        if (timer.last_was_best()) {
+            copy(phases, phases + 4, best_phases);
+        }
+
+        max_keys = static_cast<long long>(received.size());
+        MPI_Allreduce(MPI_IN_PLACE, &max_keys, 1, MPI_LONG_LONG, MPI_MAX, MPI_COMM_WORLD);
+        if (options.verify && run == 0) {
+            sorted = check_sorted(received, options.keys, input_sum, rank, size, MPI_COMM_WORLD);
+        }
+    }
+
+    const BenchStats& stats = timer.stats();
+    if (rank == 0) {
+        double average = static_cast<double>(options.keys) / size;
+        cout << "Sample sort of " << options.keys << " " << options.dist << " int32 keys on " << size
+             << " ranks, " << options.oversample << " samples per rank" << endl;
+        cout << fixed << setprecision(6)
+             << "Time: best " << stats.best << " s, mean " << stats.mean << " s over "
+             << options.reps << " runs, " << setprecision(2) << options.keys / stats.best / 1e6 << " Mkeys/s" << endl;
+        cout << setprecision(6) << "Phases: local sort " << best_phases[0] << " s, splitters "
+             << best_phases[1] << " s, alltoallv " << best_phases[2] << " s, final sort "
+             << best_phases[3] << " s" << endl;
+        cout << setprecision(2) << "Balance: largest rank holds " << max_keys << " keys, "
+             << max_keys / average << "x the average" << endl;
+        if (options.verify) {
+            cout << "Verification: " << (sorted ? "passed" : "FAILED") << endl;
+        }
+    }
+    bench_report(MPI_COMM_WORLD, "parallel_sort", "sample", to_string(options.keys), stats);
+}
+
+// Merges the sorted blocks mine and theirs and keeps the keep smallest
+// (low) or largest keys in out. Only keep keys are ever touched.
+static void merge_split(const vector<int32_t>& mine, const vector<int32_t>& theirs,
+                        bool low, vector<int32_t>& out) {
+    size_t keep = mine.size();
+    out.resize(keep);
+    if (low) {
+        size_t i = 0, j = 0;
+        for (size_t k = 0; k < keep; k++) {
+            bool take_mine = j == theirs.size() || (i < mine.size() && mine[i] <= theirs[j]);
+            out[k] = take_mine ? mine[i++] : theirs[j++];
+        }
+    } else {
+        size_t i = mine.size(), j = theirs.size();
+        for (size_t k = keep; k-- > 0;) {
+            bool take_mine = j == 0 || (i > 0 && mine[i - 1] > theirs[j - 1]);
+            out[k] = take_mine ? mine[--i] : theirs[--j];
+        }
+    }
+}
+
+// Odd-even transposition over blocks: after size phases of pairwise
+// merge-splits every rank holds its own slice of the sorted order. Each
+// phase costs one MPI_Sendrecv per rank, whatever the block size, where
+// the element pipeline sends one message per key.
+void merge_split_sort(int rank, int size, const SortOptions& options) {
+    int dims[1] = {size};
+    int periods[1] = {0};
+    MPI_Comm comm;
+    cart_create_local(1, dims, periods, &comm);
+    MPI_Comm_rank(comm, &rank); // Line position, node by node
+    int left, right;
+    MPI_Cart_shift(comm, 0, 1, &left, &right);
+
+    vector<int32_t> input, keys, scratch, theirs, merged;
+    generate_keys(input, options, rank, size);
+
+    uint64_t input_sum = 0;
+    for (int32_t key : input) {
+        input_sum += static_cast<uint32_t>(key);
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &input_sum, 1, MPI_UINT64_T, MPI_SUM, comm);
+
+    double best_local = 0;
+    long messages = 0, skipped = 0;
+    bool sorted = true;
+
+    BenchTimer timer(comm, options.warmup, options.reps);
+    for (int run = 0; run < timer.runs(); run++) {
+        keys = input;
+        messages = skipped = 0;
+        timer.start();
+        double start = MPI_Wtime();
+
+        radix_sort(keys, scratch);
+        double local = MPI_Wtime() - start;
+
+        for (int phase = 0; phase < size; phase++) {
+            // Even phases pair (0,1), (2,3)...; odd phases pair (1,2), (3,4)...
+            bool lower = (rank % 2) == (phase % 2);
+            int partner = lower ? right : left;
+            if (partner == MPI_PROC_NULL) {
+                continue;
+            }
+            // Block sizes follow the initial shares and never change
+            long long partner_size = share_start(options.keys, size, partner + 1) -
+                                     share_start(options.keys, size, partner);
+            theirs.resize(partner_size);
+            MPI_Sendrecv(keys.data(), static_cast<int>(keys.size()), MPI_INT32_T, partner, phase,
+                         theirs.data(), static_cast<int>(partner_size), MPI_INT32_T, partner, phase,
+                         comm, MPI_STATUS_IGNORE);
+            messages++;
+
+            // Already ordered pairs have nothing to merge
+            if (keys.empty() || theirs.empty() ||
+                (lower ? keys.back() <= theirs.front() : theirs.back() <= keys.front())) {
+                skipped++;
+                continue;
+            }
+            merge_split(keys, theirs, lower, merged);
+            keys.swap(merged);
+        }
+
+        timer.stop();
+        MPI_Allreduce(MPI_IN_PLACE, &local, 1, MPI_DOUBLE, MPI_MAX, comm);
+        if (timer.last_was_best()) {
+            best_local = local;
+        }
+
+        if (options.verify && run == 0) {
+            sorted = check_sorted(keys, options.keys, input_sum, rank, size, comm);
+        }
+    }
+
+    long counts[2] = {messages, skipped};
+    MPI_Allreduce(MPI_IN_PLACE, counts, 2, MPI_LONG, MPI_SUM, comm);
+
+    const BenchStats& stats = timer.stats();
+    if (rank == 0) {
+        long long block = options.keys / size;
+        cout << "Merge-split sort of " << options.keys << " " << options.dist << " int32 keys on a "
+             << size << "-rank line, blocks of " << block << (options.keys % size ? "+1" : "") << " keys" << endl;
+        cout << fixed << setprecision(6)
+             << "Time: best " << stats.best << " s, mean " << stats.mean << " s over "
+             << options.reps << " runs, " << setprecision(2) << options.keys / stats.best / 1e6 << " Mkeys/s" << endl;
+        cout << setprecision(6) << "Phases: local sort " << best_local << " s, "
+             << size << " merge-split phases " << stats.best - best_local << " s" << endl;
+        cout << "Messages: " << counts[0] << " block exchanges (" << counts[1]
+             << " already ordered), element pipeline would send about "
+             << options.keys * size << endl;
+        if (options.verify) {
+            cout << "Verification: " << (sorted ? "passed" : "FAILED") << endl;
+        }
+    }
+    bench_report(comm, "parallel_sort", "merge_split", to_string(options.keys), stats);
+
+    MPI_Comm_free(&comm);
+}
@@ -0,0 +1,38 @@
+#ifndef DISTRIBUTED_SORT_H
+#define DISTRIBUTED_SORT_H
+
+#include <mpi.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Options of the scalable sort modes, given as key=value arguments after
+// the mode name, e.g. "sample keys=100000000 reps=3".
+struct SortOptions {
+    long long keys = 1 << 24; // Total over all ranks
+    std::string dist = "uniform"; // uniform, or narrow: only 1000 distinct keys
+    int oversample = 64;      // Regular samples taken per rank for the splitters
+    unsigned seed = 1;
+    int warmup = 0;           // Untimed runs before the timed ones
+    int reps = 3;
+    bool verify = true;
+};
+
+bool parse_sort_options(int argc, char** argv, int first, SortOptions& options);
+
+// Keys of rank r are generated from their global index, so the input does
+// not depend on the rank count and nothing goes through rank 0.
+void generate_keys(std::vector<int32_t>& keys, const SortOptions& options, int rank, int size);
+
+// LSD radix sort, 8 bits per pass. Passes whose digit is the same in every
+// key are skipped. The inner loops have no data-dependent branches.
+void radix_sort(std::vector<int32_t>& keys, std::vector<int32_t>& scratch);
+
+void sample_sort(int rank, int size, const SortOptions& options);
+
+// Blocked version of the signal-flow sort: the ranks form the same linear
+// Cartesian pipeline, but each one holds a sorted block and neighbours
+// merge-split whole blocks in odd-even transposition order.
+void merge_split_sort(int rank, int size, const SortOptions& options);
+
+#endif // DISTRIBUTED_SORT_H